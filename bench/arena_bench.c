@@ -0,0 +1,171 @@
+/*
+ * Banco de pruebas de la arena del ciclo de refresco.
+ *
+ * Repite el trabajo de un ciclo de la aplicación sin red: cada respuesta
+ * llega a un ArenaBuffer en trozos, como la escribe curl, y se analiza con
+ * cJSON usando los ganchos de la arena. Tras unos ciclos de calentamiento
+ * la arena no debe volver a llamar a malloc ni los ganchos a recurrir a
+ * malloc; si lo hacen el programa termina con error.
+ *
+ * Uso: arena_bench [--cycles N] [--warmup N]
+ */
+#include "arena.h"
+#include <cjson/cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Mismos tamaños que usan las aplicaciones
+#define FETCH_ARENA_CHUNK (64 * 1024)
+#define RESPONSE_INITIAL_CAPACITY (16 * 1024)
+
+// Tamaño de cada trozo entregado al buffer (como el callback de curl)
+#define WRITE_PIECE 1024
+
+// Bloques proyectados de la respuesta del mempool: varía entre ciclos
+#define MIN_BLOCKS 5
+#define BLOCK_VARIANTS 4
+
+// Cuerpos sintéticos de las tres respuestas de un ciclo
+#define BODY_SIZE (64 * 1024)
+static char fees_body[BODY_SIZE];
+static char price_body[BODY_SIZE];
+static char blocks_body[BLOCK_VARIANTS][BODY_SIZE];
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void build_bodies(void) {
+    snprintf(fees_body, sizeof(fees_body),
+             "{\"fastestFee\":42,\"halfHourFee\":35,\"hourFee\":28,"
+             "\"economyFee\":12,\"minimumFee\":4}");
+    snprintf(price_body, sizeof(price_body),
+             "{\"time\":1700000000,\"USD\":43210,\"EUR\":39876,\"GBP\":34567}");
+
+    for (int v = 0; v < BLOCK_VARIANTS; v++) {
+        size_t len = 0;
+        len += snprintf(blocks_body[v] + len, BODY_SIZE - len, "[");
+        for (int b = 0; b < MIN_BLOCKS + v; b++) {
+            len += snprintf(blocks_body[v] + len, BODY_SIZE - len,
+                            "%s{\"blockSize\":1598765,\"blockVSize\":997654.25,\"nTx\":%d,"
+                            "\"totalFees\":%d,\"medianFee\":%.2f,\"feeRange\":[",
+                            b ? "," : "", 3000 + b * 17, 12000000 - b * 100000, 30.5 - b);
+            for (int r = 0; r < 7; r++) {
+                len += snprintf(blocks_body[v] + len, BODY_SIZE - len, "%s%.3f",
+                                r ? "," : "", 1.0 + r * 7.25 + b);
+            }
+            len += snprintf(blocks_body[v] + len, BODY_SIZE - len, "]}");
+        }
+        snprintf(blocks_body[v] + len, BODY_SIZE - len, "]");
+    }
+}
+
+/**
+ * Recibe un cuerpo en trozos y lo analiza con cJSON; devuelve la suma de
+ * los números encontrados para que el trabajo no se pueda descartar.
+ */
+static double fetch_and_parse(Arena *arena, const char *body) {
+    ArenaBuffer response;
+    arena_buffer_init(&response, arena, RESPONSE_INITIAL_CAPACITY);
+
+    size_t len = strlen(body);
+    for (size_t off = 0; off < len; off += WRITE_PIECE) {
+        size_t piece = len - off < WRITE_PIECE ? len - off : WRITE_PIECE;
+        if (!arena_buffer_append(&response, body + off, piece)) return 0;
+    }
+
+    cJSON *json = cJSON_Parse(response.data);
+    if (!json) return 0;
+
+    double sum = 0;
+    const cJSON *item = NULL;
+    cJSON_ArrayForEach(item, json) {
+        if (cJSON_IsNumber(item)) sum += item->valuedouble;
+        const cJSON *field = NULL;
+        cJSON_ArrayForEach(field, item) {
+            if (cJSON_IsNumber(field)) sum += field->valuedouble;
+        }
+    }
+    cJSON_Delete(json);
+    return sum;
+}
+
+// Un ciclo de refresco completo, terminando con el vaciado de la arena
+static double run_cycle(Arena *arena, int cycle) {
+    arena_bind(arena);
+    double sum = fetch_and_parse(arena, fees_body);
+    sum += fetch_and_parse(arena, price_body);
+    sum += fetch_and_parse(arena, blocks_body[cycle % BLOCK_VARIANTS]);
+    arena_bind(NULL);
+    arena_reset(arena);
+    return sum;
+}
+
+int main(int argc, char **argv) {
+    int cycles = 10000;
+    int warmup = BLOCK_VARIANTS * 2;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Uso: %s [--cycles N] [--warmup N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (cycles < 1) cycles = 1;
+    // El calentamiento debe ver la respuesta más grande al menos una vez
+    if (warmup < BLOCK_VARIANTS) warmup = BLOCK_VARIANTS;
+
+    build_bodies();
+
+    Arena arena;
+    arena_init(&arena, FETCH_ARENA_CHUNK);
+    cJSON_Hooks hooks = { arena_hook_malloc, arena_hook_free };
+    cJSON_InitHooks(&hooks);
+
+    double checksum = 0;
+    for (int i = 0; i < warmup; i++) {
+        checksum += run_cycle(&arena, i);
+    }
+
+    ArenaStats before;
+    arena_get_stats(&arena, &before);
+    unsigned long fallbacks_before = arena_hook_fallback_count();
+
+    double start = now_us();
+    for (int i = 0; i < cycles; i++) {
+        checksum += run_cycle(&arena, warmup + i);
+    }
+    double elapsed = now_us() - start;
+
+    ArenaStats after;
+    arena_get_stats(&arena, &after);
+    unsigned long steady_allocs = after.chunk_allocs - before.chunk_allocs;
+    unsigned long steady_fallbacks = arena_hook_fallback_count() - fallbacks_before;
+
+    printf("Ciclos: %d (calentamiento %d)\n", cycles, warmup);
+    printf("Tiempo por ciclo: %.2f us\n", elapsed / cycles);
+    printf("Reservas servidas por ciclo: %.1f\n",
+           (double)(after.allocations - before.allocations) / cycles);
+    printf("Capacidad: %zu bytes, máximo por ciclo: %zu bytes\n", after.capacity, after.high_water);
+    printf("malloc de la arena: %lu en calentamiento, %lu en régimen estable\n",
+           before.chunk_allocs, steady_allocs);
+    printf("Reservas de los ganchos fuera de la arena en régimen estable: %lu\n", steady_fallbacks);
+    printf("Suma de control: %.3f\n", checksum);
+
+    cJSON_InitHooks(NULL);
+    arena_destroy(&arena);
+
+    if (steady_allocs > 0 || steady_fallbacks > 0) {
+        fprintf(stderr, "La arena reservó memoria en régimen estable\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * Banco de pruebas del dibujado de gráficos.
+ *
+ * Construye gráficos sin ventana con series sintéticas, los dibuja sobre una
+ * superficie de imagen de cairo con varios tamaños, niveles de zoom y número
+ * de series, y muestra los percentiles del tiempo por fotograma y la memoria.
+ * Los fotogramas pasan por las cachés de capas igual que en la ventana, así
+ * que el primero (que las construye) se mide aparte de los de régimen
+ * estable. También muestra los contadores de textos maquetados.
+ * No necesita pantalla.
+ *
+ * Uso: chart_bench [--frames N] [--max-points N] [--budget-ms MS] [--csv]
+ */
+#include "chart_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Opciones de línea de comandos
+static gint opt_frames = 30;
+static gint64 opt_max_points = 1000000;
+static gdouble opt_budget_ms = 0;
+static gboolean opt_csv = FALSE;
+
+static GOptionEntry entries[] = {
+    { "frames", 'f', 0, G_OPTION_ARG_INT, &opt_frames, "Fotogramas medidos por caso", "N" },
+    { "max-points", 'p', 0, G_OPTION_ARG_INT64, &opt_max_points, "Puntos máximos por serie (hasta 10000000)", "N" },
+    { "budget-ms", 'b', 0, G_OPTION_ARG_DOUBLE, &opt_budget_ms, "Falla si algún caso supera este p90", "MS" },
+    { "csv", 0, 0, G_OPTION_ARG_NONE, &opt_csv, "Salida en CSV", NULL },
+    { NULL }
+};
+
+// Casos medidos
+typedef struct {
+    int width;
+    int height;
+} BenchSize;
+
+static const gint64 point_counts[] = { 1000, 10000, 100000, 1000000, 10000000 };
+static const BenchSize sizes[] = { { 640, 240 }, { 1280, 480 }, { 2560, 960 } };
+static const double zoom_levels[] = { 1.0, 4.0, 20.0 };
+static const int series_counts[] = { 1, 4 };
+
+// Resultado de un caso
+typedef struct {
+    double first_ms;   // Primer fotograma (construye las cachés)
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double max_ms;
+    guint layouts_cached;   // Textos en la caché al terminar
+    guint layouts_steady;   // Textos maquetados en régimen estable (debería ser 0)
+} BenchResult;
+
+// Memoria residente actual y pico del proceso en kB
+static void read_memory(long *rss_kb, long *peak_kb) {
+    *rss_kb = 0;
+    *peak_kb = 0;
+
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return;
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "VmRSS:", 6) == 0) *rss_kb = strtol(line + 6, NULL, 10);
+        if (strncmp(line, "VmHWM:", 6) == 0) *peak_kb = strtol(line + 6, NULL, 10);
+    }
+    fclose(f);
+}
+
+/**
+ * Crea un gráfico sin ventana con `series_count` paseos aleatorios de
+ * `points` muestras, una por segundo. La semilla es fija para que los
+ * resultados sean comparables entre ejecuciones.
+ */
+static ChartConfig *build_chart(gint64 points, int series_count) {
+    ChartConfig *chart = chart_config_new_offscreen("bench");
+    for (int s = 0; s < series_count; s++) {
+        char label[32];
+        snprintf(label, sizeof(label), "Serie %d", s + 1);
+        chart_add_series(chart, label, NULL, TRUE);
+    }
+
+    GRand *rand = g_rand_new_with_seed(42);
+    double values[4] = { 20, 15, 10, 5 };
+    time_t start = 1700000000;
+    for (gint64 i = 0; i < points; i++) {
+        for (int s = 0; s < series_count; s++) {
+            values[s] = fabs(values[s] + g_rand_double_range(rand, -1.0, 1.0));
+        }
+        chart_append_values(chart, start + (time_t)i, NULL, values, series_count);
+    }
+    g_rand_free(rand);
+
+    return chart;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+// Percentil q (0..1) de una muestra ordenada
+static double percentile(const double *sorted, int n, double q) {
+    int index = (int)ceil(q * n) - 1;
+    if (index < 0) index = 0;
+    if (index >= n) index = n - 1;
+    return sorted[index];
+}
+
+static double render_frame_ms(ChartConfig *chart, cairo_t *cr, cairo_surface_t *surface,
+                              int width, int height) {
+    gint64 start = g_get_monotonic_time();
+    chart_draw_cached(chart, cr, width, height);
+    cairo_surface_flush(surface);
+    return (g_get_monotonic_time() - start) / 1000.0;
+}
+
+/**
+ * Mide un caso. En modo en vivo cada fotograma añade antes una muestra a
+ * cada serie, como hace la aplicación en cada refresco.
+ */
+static BenchResult run_case(ChartConfig *chart, int series_count, BenchSize size,
+                            double zoom, gboolean live) {
+    BenchResult result = { 0 };
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size.width, size.height);
+    cairo_t *cr = cairo_create(surface);
+
+    ChartViewport *viewport = chart->viewport;
+    chart_viewport_zoom_at(viewport, zoom, (viewport->min_x + viewport->max_x) / 2, 0.5);
+
+    result.first_ms = render_frame_ms(chart, cr, surface, size.width, size.height);
+
+    double *samples = g_new(double, opt_frames);
+    double values[4] = { 20, 15, 10, 5 };
+    ChartTextStats stats;
+    for (int i = 0; i < opt_frames; i++) {
+        if (live) {
+            chart_append_values(chart, (time_t)viewport->max_x + 1, NULL, values, series_count);
+        }
+        samples[i] = render_frame_ms(chart, cr, surface, size.width, size.height);
+        chart_get_text_stats(chart, &stats);
+        result.layouts_steady += stats.created_last_frame;
+    }
+    chart_get_text_stats(chart, &stats);
+    result.layouts_cached = stats.cached;
+
+    qsort(samples, opt_frames, sizeof(double), compare_double);
+    result.p50_ms = percentile(samples, opt_frames, 0.50);
+    result.p90_ms = percentile(samples, opt_frames, 0.90);
+    result.p99_ms = percentile(samples, opt_frames, 0.99);
+    result.max_ms = samples[opt_frames - 1];
+    g_free(samples);
+
+    chart_viewport_reset(viewport);
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    GError *error = NULL;
+    GOptionContext *context = g_option_context_new("- rendimiento del dibujado de gráficos");
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        fprintf(stderr, "Error: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return 2;
+    }
+    g_option_context_free(context);
+
+    if (opt_frames < 1) opt_frames = 1;
+
+    if (opt_csv) {
+        printf("points,series,width,height,zoom,mode,first_ms,p50_ms,p90_ms,p99_ms,max_ms,"
+               "layouts_cached,layouts_steady,data_mb,rss_mb\n");
+    } else {
+        printf("%10s %6s %11s %5s %8s %9s %8s %8s %8s %8s %7s %7s %9s %9s\n",
+               "puntos", "series", "tamaño", "zoom", "modo", "primero",
+               "p50", "p90", "p99", "máx", "textos", "nuevos", "datos MB", "RSS MB");
+    }
+
+    int over_budget = 0;
+    for (size_t p = 0; p < G_N_ELEMENTS(point_counts); p++) {
+        if (point_counts[p] > opt_max_points) break;
+
+        for (size_t c = 0; c < G_N_ELEMENTS(series_counts); c++) {
+            int series_count = series_counts[c];
+            ChartConfig *chart = build_chart(point_counts[p], series_count);
+
+            long rss_kb, peak_kb;
+            read_memory(&rss_kb, &peak_kb);
+            double data_mb = point_counts[p] * series_count * sizeof(ChartDataPoint) / (1024.0 * 1024.0);
+
+            for (size_t s = 0; s < G_N_ELEMENTS(sizes); s++) {
+                for (size_t z = 0; z < G_N_ELEMENTS(zoom_levels); z++) {
+                    for (int live = 0; live <= 1; live++) {
+                        BenchResult r = run_case(chart, series_count, sizes[s], zoom_levels[z], live);
+                        const char *mode = live ? "vivo" : "estático";
+
+                        if (opt_csv) {
+                            printf("%" G_GINT64_FORMAT ",%d,%d,%d,%.0f,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%u,%u,%.1f,%.1f\n",
+                                   point_counts[p], series_count, sizes[s].width, sizes[s].height,
+                                   zoom_levels[z], live ? "live" : "static", r.first_ms, r.p50_ms,
+                                   r.p90_ms, r.p99_ms, r.max_ms, r.layouts_cached, r.layouts_steady,
+                                   data_mb, rss_kb / 1024.0);
+                        } else {
+                            char size_text[16];
+                            snprintf(size_text, sizeof(size_text), "%dx%d", sizes[s].width, sizes[s].height);
+                            printf("%10" G_GINT64_FORMAT " %6d %11s %5.0f %8s %9.2f %8.2f %8.2f %8.2f %8.2f %7u %7u %9.1f %9.1f\n",
+                                   point_counts[p], series_count, size_text, zoom_levels[z], mode,
+                                   r.first_ms, r.p50_ms, r.p90_ms, r.p99_ms, r.max_ms,
+                                   r.layouts_cached, r.layouts_steady, data_mb, rss_kb / 1024.0);
+                        }
+                        fflush(stdout);
+
+                        if (opt_budget_ms > 0 && r.p90_ms > opt_budget_ms) over_budget++;
+                    }
+                }
+            }
+
+            chart_config_free(chart);
+        }
+    }
+
+    long rss_kb, peak_kb;
+    read_memory(&rss_kb, &peak_kb);
+    fprintf(stderr, "Memoria pico: %.1f MB\n", peak_kb / 1024.0);
+
+    if (over_budget > 0) {
+        fprintf(stderr, "%d casos superan el presupuesto de %.2f ms (p90)\n", over_budget, opt_budget_ms);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bloque de memoria de la arena
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t size;    // Bytes útiles del bloque
+    size_t used;    // Bytes ocupados
+    unsigned char data[];
+} ArenaChunk;
+
+// Contadores de la arena (para verificar cero reservas en régimen estable)
+typedef struct {
+    unsigned long chunk_allocs;    // Llamadas a malloc hechas por la arena
+    unsigned long chunk_frees;     // Llamadas a free hechas por la arena
+    unsigned long allocations;     // Reservas servidas desde la arena
+    unsigned long resets;          // Ciclos completados
+    size_t bytes_used;             // Bytes ocupados en el ciclo actual
+    size_t high_water;             // Máximo de bytes ocupados en un ciclo
+    size_t capacity;               // Bytes reservados en bloques
+} ArenaStats;
+
+// Arena de asignación lineal que se vacía al final de cada ciclo de refresco
+typedef struct {
+    ArenaChunk *chunks;     // Lista de bloques
+    ArenaChunk *current;    // Bloque en uso
+    size_t chunk_size;      // Tamaño mínimo de un bloque nuevo
+    void *last_alloc;       // Última reserva (se puede ampliar in situ)
+    ArenaStats stats;
+} Arena;
+
+// Buffer creciente respaldado por una arena (cuerpos de respuesta HTTP)
+typedef struct {
+    Arena *arena;
+    char *data;        // Siempre terminado en '\0'
+    size_t len;
+    size_t capacity;
+} ArenaBuffer;
+
+/**
+ * Inicializa una arena; el primer bloque se reserva en el primer uso
+ */
+void arena_init(Arena *arena, size_t chunk_size);
+
+/**
+ * Libera todos los bloques de la arena
+ */
+void arena_destroy(Arena *arena);
+
+/**
+ * Reserva memoria alineada dentro de la arena
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * Amplía una reserva; si es la última se amplía sin copiar
+ */
+void *arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+/**
+ * Indica si un puntero pertenece a la arena
+ */
+int arena_contains(const Arena *arena, const void *ptr);
+
+/**
+ * Vacía la arena conservando los bloques para el siguiente ciclo.
+ * Si el ciclo necesitó varios bloques se sustituyen por uno solo
+ * del tamaño total, de modo que en régimen estable no hay reservas.
+ */
+void arena_reset(Arena *arena);
+
+/**
+ * Copia los contadores de la arena
+ */
+void arena_get_stats(const Arena *arena, ArenaStats *stats);
+
+/**
+ * Asocia la arena al hilo actual para los ganchos de reserva (NULL desasocia)
+ */
+void arena_bind(Arena *arena);
+
+/**
+ * Ganchos compatibles con cJSON_InitHooks(). Con una arena asociada al hilo
+ * las reservas salen de ella y free() de sus punteros no hace nada; sin
+ * arena se delega en malloc/free. Los árboles cJSON creados con una arena
+ * asociada deben liberarse antes de desasociarla.
+ */
+void *arena_hook_malloc(size_t size);
+void arena_hook_free(void *ptr);
+
+/**
+ * Reservas hechas por los ganchos con malloc al no haber arena asociada
+ */
+unsigned long arena_hook_fallback_count(void);
+
+/**
+ * Inicializa un buffer vacío con la capacidad inicial indicada
+ */
+void arena_buffer_init(ArenaBuffer *buf, Arena *arena, size_t initial_capacity);
+
+/**
+ * Añade datos al buffer; devuelve 0 si no hay memoria
+ */
+int arena_buffer_append(ArenaBuffer *buf, const void *data, size_t len);
+
+#endif // ARENA_H
@@ -0,0 +1,96 @@
+#ifndef BRAILLE_GRAPH_H
+#define BRAILLE_GRAPH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Subpíxeles por celda de texto (patrones braille U+2800-U+28FF)
+#define BRAILLE_CELL_WIDTH 2
+#define BRAILLE_CELL_HEIGHT 4
+
+// Lienzo de puntos braille. Guarda lo dibujado en el terminal para que cada
+// volcado solo envíe las celdas que cambiaron.
+typedef struct {
+    int cols, rows;         // Tamaño en celdas
+    uint8_t *dots;          // Puntos de cada celda (bits del patrón braille)
+    uint8_t *colors;        // Color de cada celda (0 = sin color; gana el mayor)
+    uint8_t *drawn_dots;    // Contenido ya enviado al terminal
+    uint8_t *drawn_colors;
+    int valid;              // drawn_* refleja el terminal
+} BrailleCanvas;
+
+// Serie en curso sobre un lienzo. Las muestras llegan en orden de x y se
+// reducen a mínimo y máximo por columna de subpíxeles, así que ningún pico se
+// pierde aunque haya muchas más muestras que columnas.
+typedef struct {
+    BrailleCanvas *canvas;
+    double x_min, x_scale;  // x -> columna de subpíxel
+    double y_max, y_scale;  // y -> fila de subpíxel (0 arriba)
+    uint8_t color;
+    
+    int column;             // Columna en curso (-1 antes de la primera muestra)
+    int first, last;        // Primera y última fila de la columna en curso
+    int low, high;          // Extremos de la columna en curso
+    int prev_column;        // Última columna volcada (-1 si ninguna)
+    int prev_last;
+} BraillePlot;
+
+// Recibe cada celda cambiada como texto UTF-8 ("" para una celda vacía)
+typedef void (*BrailleCellFunc)(void *user_data, int col, int row, const char *utf8, uint8_t color);
+
+/**
+ * Ajusta el tamaño del lienzo (en celdas). Lo deja vacío e invalidado.
+ * Devuelve 0 si no hay memoria.
+ */
+int braille_canvas_resize(BrailleCanvas *canvas, int cols, int rows);
+
+/**
+ * Libera la memoria del lienzo
+ */
+void braille_canvas_free(BrailleCanvas *canvas);
+
+/**
+ * Borra los puntos; el próximo volcado solo envía lo que cambie
+ */
+void braille_canvas_clear(BrailleCanvas *canvas);
+
+/**
+ * Borra los puntos de las celdas con columna en [col_from, col_to) para
+ * volver a trazar solo esa parte
+ */
+void braille_canvas_clear_cells(BrailleCanvas *canvas, int col_from, int col_to);
+
+/**
+ * Olvida lo dibujado: el próximo volcado envía todas las celdas
+ */
+void braille_canvas_invalidate(BrailleCanvas *canvas);
+
+/**
+ * Enciende un subpíxel. Las coordenadas fuera del lienzo se ignoran. Si la
+ * celda ya tiene color se queda el mayor.
+ */
+void braille_canvas_set(BrailleCanvas *canvas, int px, int py, uint8_t color);
+
+/**
+ * Envía las celdas que cambiaron desde el último volcado y las marca como
+ * dibujadas. Devuelve el número de celdas enviadas.
+ */
+int braille_canvas_flush(BrailleCanvas *canvas, BrailleCellFunc func, void *user_data);
+
+/**
+ * Empieza una serie con los rangos dados (y_max > y_min, x_max >= x_min)
+ */
+void braille_plot_begin(BraillePlot *plot, BrailleCanvas *canvas, double x_min, double x_max,
+                        double y_min, double y_max, uint8_t color);
+
+/**
+ * Añade una muestra a la serie
+ */
+void braille_plot_point(BraillePlot *plot, double x, double y);
+
+/**
+ * Termina la serie dibujando la última columna
+ */
+void braille_plot_end(BraillePlot *plot);
+
+#endif // BRAILLE_GRAPH_H
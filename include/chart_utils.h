@@ -11,6 +11,43 @@ typedef struct {
     double y;  // y-coordinate (value)
 } ChartDataPoint;
 
+// Chart types
+typedef enum {
+    CHART_TYPE_LINE,     // Line chart
+    CHART_TYPE_AREA,     // Area chart
+    CHART_TYPE_BAR,      // Bar chart
+    CHART_TYPE_CANDLE    // Velas japonesas
+} ChartType;
+
+// Configuración de velas japonesas
+typedef struct {
+    double open;
+    double high;
+    double low;
+    double close;
+    time_t timestamp;    // Inicio del intervalo
+} CandleData;
+
+// Agregador OHLC incremental de un flujo de muestras
+typedef struct {
+    int64_t interval;    // Duración de cada vela en segundos (0 = desactivado)
+    CandleData current;  // Vela en curso
+    gboolean has_current;
+} CandleAggregator;
+
+// Stable handle of a series inside its chart (index in registration order)
+typedef int ChartSeriesHandle;
+#define CHART_INVALID_SERIES (-1)
+
+// Decimated copy of a series for a given viewport and width
+typedef struct {
+    GArray *points;        // ChartDataPoint, at most 4 per pixel column
+    guint revision;        // Series data revision the cache was built from
+    double min_x, max_x;   // Visible x range the cache was built for
+    int width;             // Pixel width the cache was built for
+    gboolean valid;        // Whether the cache can be reused
+} ChartDecimation;
+
 // Structure for a chart series
 typedef struct {
     char *label;           // Series label
@@ -18,62 +55,191 @@ typedef struct {
     GArray *data;          // Array of ChartDataPoint
     gboolean show_points;  // Whether to show data points
     gboolean visible;      // Whether the series is visible
+    guint data_revision;             // Bumped whenever data changes
+    ChartDecimation decimation;      // Per-column min/max reduction of data
+    guint plotted_count;             // Points already plotted in the data layer
+    guint plotted_revision;          // Data revision when the data layer was last updated
 } ChartSeries;
 
+// Offscreen layers for the parts of the chart that rarely change
+typedef struct {
+    cairo_surface_t *background;  // Background and grid, drawn under the data
+    cairo_surface_t *legend;      // Legend box, drawn over the data
+    int legend_x, legend_y;       // Legend position in widget coordinates
+    int width, height;            // Widget size the layers were rendered for
+    int scale;                    // Widget scale factor the layers were rendered for
+    gboolean valid;               // Cleared by chart_invalidate_layers()
+} ChartLayerCache;
+
+// Backing surface with the plotted series. When the window slides it is
+// scrolled by whole pixels and only the newly exposed strip is plotted.
+typedef struct {
+    cairo_surface_t *surface;     // Plotted series on a transparent background
+    cairo_surface_t *spare;       // Scroll target, swapped with surface
+    double view_start, view_end;  // X range held by the surface (start snapped to whole pixels)
+    double min_y, max_y;          // Y range the surface was plotted with
+    int width, height;            // Widget size the surface was plotted for
+    int scale;                    // Widget scale factor the surface was plotted for
+    gboolean valid;               // Whether incremental updates can be applied
+} ChartDataLayer;
+
+// Monotonic queue of samples for sliding-window extremes: y values are kept
+// increasing (min queue) or decreasing (max queue) from the head, so the head
+// is always the extreme of the samples still in the window
+typedef struct {
+    GArray *points;        // ChartDataPoint in time order
+    guint head;            // First live element
+} ChartExtremaQueue;
+
+// Incremental y autoscaling state
+typedef struct {
+    ChartExtremaQueue min_queue;     // Window minimum at the head
+    ChartExtremaQueue max_queue;     // Window maximum at the head
+    gboolean queues_valid;           // FALSE forces the queues to be rebuilt from the data
+    double queue_start;              // Window start the queues were last evicted to
+    guint revision;                  // Bumped whenever the visible data changes
+    guint scanned_revision;          // Revision of the last zoomed or candle scan
+    double scanned_start, scanned_end; // X range of the last scan
+    gboolean scanned_valid;          // Whether the scan result can be reused
+    double data_min, data_max;       // Extremes of the visible data
+    gboolean has_data;               // Whether any visible sample exists
+} ChartAutoscale;
+
+// Time axis shared by linked charts: one x range, zoom and pan, so a pan or
+// zoom on any of them moves all of them. Every chart has one; unlinked charts
+// keep a private viewport.
+typedef struct {
+    double min_x, max_x;          // Union of the subscribed charts' x ranges
+    double zoom_level;            // Current zoom level
+    double pan_offset;            // Visible range start, as an offset from min_x
+    double view_start, view_end;  // Visible range, recomputed on every change
+    GPtrArray *charts;            // Subscribed ChartConfig (not owned)
+    guint revision;               // Bumped whenever the visible range changes
+    int ref_count;
+} ChartViewport;
+
+// Crosshair overlay under the pointer. It is drawn over the cached layers and
+// only its own area is redrawn when the pointer moves. It is anchored in data
+// space and re-placed when the viewport, the data or the y range change.
+#define CHART_HOVER_MAX_MARKERS 8
+typedef struct {
+    gboolean active;              // Overlay placed and on screen
+    gboolean pointer_in;          // Pointer over the chart
+    double data_x;                // Hovered x in data space (timestamp)
+    guint viewport_revision;      // Viewport revision the overlay was placed for
+    guint data_revision;          // Autoscale revision the overlay was placed for
+    double min_y, max_y;          // Y range the overlay was placed for
+    int width, height;            // Widget size the overlay was placed for
+    PangoLayout *layout;          // Tooltip text, reused across moves
+    double line_x;                // Crosshair x, snapped to the nearest sample
+    int marker_count;             // Samples highlighted on the crosshair
+    double marker_y[CHART_HOVER_MAX_MARKERS];
+    GdkRGBA marker_color[CHART_HOVER_MAX_MARKERS];
+    char text[256];               // Tooltip text
+    GdkRectangle box;             // Tooltip box
+    GdkRectangle bounds;          // Everything the overlay paints
+} ChartHover;
+
+// Text layout cache counters
+typedef struct {
+    guint cached;              // Layouts currently cached
+    guint created_total;       // Layouts created since the chart was built
+    guint created_last_frame;  // Layouts created by the last frame (0 in steady state)
+} ChartTextStats;
+
 // Chart configuration structure
 typedef struct {
-    GtkWidget *drawing_area;  // Drawing area widget
-    GList *series;            // List of ChartSeries
+    GtkWidget *drawing_area;  // Drawing area widget (NULL for offscreen charts)
+    GPtrArray *series;        // ChartSeries indexed by ChartSeriesHandle
     char *title;              // Chart title
     GdkRGBA bg_color;         // Background color
     GdkRGBA grid_color;       // Grid color
     GdkRGBA text_color;       // Text color
-    double min_x, max_x;      // X-axis range
+    double min_x, max_x;      // X range of this chart's data
+    gboolean has_x_range;     // min_x/max_x come from data or chart_set_time_range()
     double min_y, max_y;      // Y-axis range
-    double zoom_level;        // Current zoom level
-    double pan_offset;        // Current pan offset
+    ChartViewport *viewport;  // Visible x range, zoom and pan (possibly shared)
+    gboolean x_range_fixed;   // Set by chart_set_time_range(); otherwise x follows the data
+    double time_window;       // Seconds shown while following the data (0 = whole history)
+    gboolean dragging;        // Pan drag in progress
+    double drag_last_x;       // Pointer x at the previous drag event
+    GArray *marker_scratch;   // Reused marker positions (ChartDataPoint, screen space)
+    ChartLayerCache layers;   // Cached static layers
+    ChartDataLayer data_layer; // Incrementally updated series layer
+    gboolean dirty;           // Redraw pending
+    guint tick_id;            // Frame clock callback while a redraw is pending
+    GHashTable *text_cache;   // "font|text" -> shaped PangoLayout
+    ChartTextStats text_stats; // Layout cache counters
+    ChartType type;           // How series are rendered
+    GArray *candles;          // CandleData sorted by timestamp
+    int64_t candle_interval;  // Seconds covered by each candle
+    gboolean auto_scale;      // Fit the y range to the visible data
+    gboolean log_scale;       // Logarithmic y axis
+    double y_padding;         // Fraction of the data span added above and below
+    ChartAutoscale autoscale; // Incremental visible extremes
+    ChartHover hover;         // Crosshair and tooltip
 } ChartConfig;
 
+// Image formats for chart export
+typedef enum {
+    CHART_EXPORT_PNG,
+    CHART_EXPORT_SVG
+} ChartExportFormat;
+
+// Size used when an export does not give one and the chart has no allocation
+#define CHART_EXPORT_DEFAULT_WIDTH 800
+#define CHART_EXPORT_DEFAULT_HEIGHT 400
+
 // Public functions
 ChartConfig* chart_config_new(GtkWidget *parent, const char *title);
+ChartConfig* chart_config_new_offscreen(const char *title);
+GtkWidget* chart_attach_widget(ChartConfig *config, GtkWidget *parent);
+ChartConfig* chart_config_copy(const ChartConfig *config);
 void chart_config_free(ChartConfig *config);
-void chart_add_series(ChartConfig *config, const char *label, const GdkRGBA *color, 
-                     gboolean show_points);
-void chart_add_data(ChartConfig *config, int series_index, double value);
+ChartSeriesHandle chart_add_series(ChartConfig *config, const char *label, const GdkRGBA *color, 
+                                   gboolean show_points);
+ChartSeries* chart_get_series(ChartConfig *config, ChartSeriesHandle handle);
+ChartSeriesHandle chart_find_series(ChartConfig *config, const char *label);
+void chart_append_values(ChartConfig *config, time_t timestamp, const ChartSeriesHandle *handles,
+                         const double *values, int count);
+void chart_add_data(ChartConfig *config, ChartSeriesHandle handle, double value);
 void chart_add_point(ChartConfig *chart, const char *series_name, time_t timestamp, double value);
-void chart_clear_series(ChartConfig *config, int series_index);
+void chart_clear_series(ChartConfig *config, ChartSeriesHandle handle);
+void chart_set_series_visible(ChartConfig *config, ChartSeriesHandle handle, gboolean visible);
+void chart_invalidate_layers(ChartConfig *config);
+void chart_get_text_stats(const ChartConfig *config, ChartTextStats *stats);
 void chart_redraw(ChartConfig *config);
 void chart_set_time_range(ChartConfig *config, int64_t start, int64_t end);
+void chart_set_time_window(ChartConfig *config, double seconds);
+void chart_get_visible_range(const ChartConfig *config, double *start, double *end);
 void chart_reset_zoom(ChartConfig *config);
 
+// Linked time axes
+ChartViewport* chart_viewport_new(void);
+ChartViewport* chart_viewport_ref(ChartViewport *viewport);
+void chart_viewport_unref(ChartViewport *viewport);
+void chart_link_viewport(ChartConfig *config, ChartViewport *viewport);
+void chart_viewport_reset(ChartViewport *viewport);
+void chart_viewport_zoom_at(ChartViewport *viewport, double zoom_level, double data_x, double fraction);
+void chart_set_y_range(ChartConfig *config, double min_y, double max_y);
+void chart_set_auto_scale(ChartConfig *config, gboolean auto_scale, double padding);
+void chart_set_log_scale(ChartConfig *config, gboolean log_scale);
+double chart_nice_step(double raw_step);
+
 // Drawing functions
 gboolean chart_draw_cb(GtkWidget *widget, cairo_t *cr, gpointer user_data);
 void chart_draw_grid(ChartConfig *config, cairo_t *cr, int width, int height);
 void chart_draw_series(ChartConfig *config, cairo_t *cr, int width, int height);
 void chart_draw_legend(ChartConfig *config, cairo_t *cr, int width, int height);
+void chart_render(ChartConfig *config, cairo_t *cr, int width, int height);
+void chart_draw_cached(ChartConfig *config, cairo_t *cr, int width, int height);
 
 // Event handlers
 gboolean chart_motion_notify_cb(GtkWidget *widget, GdkEventMotion *event, gpointer user_data);
 gboolean chart_button_press_cb(GtkWidget *widget, GdkEventButton *event, gpointer user_data);
 gboolean chart_button_release_cb(GtkWidget *widget, GdkEventButton *event, gpointer user_data);
 gboolean chart_scroll_cb(GtkWidget *widget, GdkEventScroll *event, gpointer user_data);
-
-// Chart types
-typedef enum {
-    CHART_TYPE_LINE,     // Line chart
-    CHART_TYPE_AREA,     // Area chart
-    CHART_TYPE_BAR,      // Bar chart
-    CHART_TYPE_CANDLE    // Velas japonesas
-} ChartType;
-
-// Configuración de velas japonesas
-typedef struct {
-    double open;
-    double high;
-    double low;
-    double close;
-    time_t timestamp;
-} CandleData;
+gboolean chart_leave_notify_cb(GtkWidget *widget, GdkEventCrossing *event, gpointer user_data);
 
 // Configuración avanzada de gráficos
 typedef struct {
@@ -85,13 +251,30 @@ typedef struct {
     int update_interval;      // Intervalo de actualización
 } ChartAdvancedConfig;
 
+// Agregación de velas
+void candle_aggregator_init(CandleAggregator *agg, int64_t interval);
+gboolean candle_aggregator_push(CandleAggregator *agg, time_t timestamp, double value, CandleData *closed);
+gboolean candle_aggregator_current(const CandleAggregator *agg, CandleData *current);
+
 // Funciones avanzadas
 void chart_set_type(ChartConfig *config, ChartType type);
 void chart_set_advanced_config(ChartConfig *config, const ChartAdvancedConfig *adv_config);
 void chart_add_candle_data(ChartConfig *config, const CandleData *candles, int count);
+void chart_clear_candles(ChartConfig *config);
+void chart_rebuild_candles(ChartConfig *config, ChartSeriesHandle handle, int64_t interval,
+                           CandleAggregator *agg);
 void chart_enable_zoom(ChartConfig *config, gboolean enable);
 void chart_enable_pan(ChartConfig *config, gboolean enable);
-void chart_export_to_png(ChartConfig *config, const char *filename);
-void chart_export_to_svg(ChartConfig *config, const char *filename);
+
+// Export. Sizes <= 0 use the widget allocation or the default size. The async
+// variant copies the chart on the calling thread and renders the copy on a worker.
+gboolean chart_export(ChartConfig *config, ChartExportFormat format, const char *filename,
+                      int width, int height, GError **error);
+gboolean chart_export_to_png(ChartConfig *config, const char *filename, int width, int height, GError **error);
+gboolean chart_export_to_svg(ChartConfig *config, const char *filename, int width, int height, GError **error);
+void chart_export_async(ChartConfig *config, ChartExportFormat format, const char *filename,
+                        int width, int height, GCancellable *cancellable,
+                        GAsyncReadyCallback callback, gpointer user_data);
+gboolean chart_export_finish(GAsyncResult *result, GError **error);
 
 #endif // CHART_UTILS_H
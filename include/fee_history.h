@@ -0,0 +1,84 @@
+#ifndef FEE_HISTORY_H
+#define FEE_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Identificación del archivo del historial
+#define FEE_HISTORY_MAGIC 0x48454546u   // "FEEH"
+#define FEE_HISTORY_VERSION 1
+#define FEE_HISTORY_MAX_CAPACITY ((size_t)16 * 1024 * 1024)  // Puntos (512 MiB)
+
+// Punto del historial. Tamaño fijo de 32 bytes: es el formato del archivo.
+typedef struct {
+    double fastest;
+    double halfHour;
+    double hour;
+    int64_t timestamp;
+} FeeHistoryPoint;
+
+// Cabecera del archivo, seguida de `capacity` puntos
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    uint64_t head;          // Próxima posición que se escribe
+    uint64_t size;          // Puntos válidos
+} FeeHistoryHeader;
+
+// Anillo de tarifas proyectado en memoria desde un archivo de tamaño fijo.
+// Cada punto se escribe directamente en el mapa, así que persiste sin
+// llamadas de escritura, y al abrirlo no se lee nada: las páginas se cargan
+// cuando se usan, de modo que el arranque no depende de la capacidad.
+typedef struct {
+    FeeHistoryHeader *header;
+    FeeHistoryPoint *points;
+    size_t map_size;
+    int fd;                 // -1 si el historial solo está en memoria
+} FeeHistory;
+
+/**
+ * Abre el anillo en `path`, creando los directorios que falten. Un archivo
+ * existente conserva su capacidad salvo que `resize` la cambie a `capacity`
+ * (se copian los puntos más recientes a uno nuevo); si no existe se crea con
+ * `capacity`. Solo se reinicia un archivo vacío o con la cabecera de un
+ * anillo. Sin ruta, o si el archivo no se puede usar (otra instancia lo
+ * tiene abierto, no es un historial...), el historial queda solo en memoria.
+ * Devuelve 0 si no hay memoria.
+ */
+int fee_history_open(FeeHistory *history, const char *path, size_t capacity, int resize);
+
+/**
+ * Ruta por defecto: ~/.local/share/btc-fee-tracker/history.ring. Devuelve 0
+ * si no cabe en el buffer o no se conoce el directorio personal.
+ */
+int fee_history_default_path(char *buffer, size_t size);
+
+/**
+ * Añade un punto; al llenarse sustituye al más antiguo
+ */
+void fee_history_add(FeeHistory *history, double fastest, double halfHour, double hour, time_t timestamp);
+
+/**
+ * Número de puntos guardados
+ */
+size_t fee_history_size(const FeeHistory *history);
+
+/**
+ * Punto i-ésimo en orden cronológico (0 = el más antiguo)
+ */
+const FeeHistoryPoint *fee_history_point(const FeeHistory *history, size_t i);
+
+/**
+ * Posición cronológica del primer punto con marca de tiempo >= `timestamp`
+ * (búsqueda binaria; fee_history_size() si no hay ninguno)
+ */
+size_t fee_history_lower_bound(const FeeHistory *history, time_t timestamp);
+
+/**
+ * Libera el mapa y cierra el archivo
+ */
+void fee_history_close(FeeHistory *history);
+
+#endif // FEE_HISTORY_H
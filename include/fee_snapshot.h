@@ -0,0 +1,84 @@
+#ifndef FEE_SNAPSHOT_H
+#define FEE_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "mempool_depth.h"
+
+// Métricas de un refresco. Solo campos de 8 bytes para que no haya relleno
+// y el contenido se pueda comparar como un bloque.
+typedef struct {
+    // Tarifas (sat/vB)
+    double fastest_fee;
+    double half_hour_fee;
+    double hour_fee;
+    double economy_fee;
+    double minimum_fee;
+
+    // Precio
+    double btc_price_usd;
+    double btc_price_eur;
+    double price_change_24h;
+
+    // Mempool
+    int64_t mempool_tx_count;
+    int64_t mempool_vsize;      // vbytes
+    double mempool_total_fee;   // BTC
+    double mempool_avg_fee;     // sat/vB
+} FeeMetrics;
+
+// Instantánea inmutable y con contador de referencias compartida por todos
+// los consumidores (interfaz, base de datos, CSV, alertas, exportadores)
+typedef struct {
+    FeeMetrics metrics;
+    MempoolDepth *depth;    // Histograma y bloques proyectados (puede ser NULL)
+    char source[32];        // Fuente de los datos
+    double latency_ms;      // Duración del refresco
+    uint64_t sequence;      // Número de refresco (crece siempre)
+    uint64_t version;       // Solo crece cuando cambian las métricas
+    time_t timestamp;       // Momento del refresco
+    atomic_int refcount;
+} FeeSnapshot;
+
+/**
+ * Crea una instantánea con una referencia. Si se indica una base, parte de
+ * sus métricas y su profundidad para que un fallo parcial conserve los
+ * últimos valores.
+ */
+FeeSnapshot *fee_snapshot_new(const FeeSnapshot *base);
+
+/**
+ * Añade una referencia y devuelve la misma instantánea
+ */
+FeeSnapshot *fee_snapshot_ref(FeeSnapshot *snapshot);
+
+/**
+ * Quita una referencia; la última libera la instantánea
+ */
+void fee_snapshot_unref(FeeSnapshot *snapshot);
+
+/**
+ * Establece el nombre de la fuente de datos
+ */
+void fee_snapshot_set_source(FeeSnapshot *snapshot, const char *source);
+
+/**
+ * Sustituye la profundidad de la mempool; la instantánea se queda con la
+ * referencia recibida
+ */
+void fee_snapshot_set_depth(FeeSnapshot *snapshot, MempoolDepth *depth);
+
+/**
+ * Asigna secuencia y versión respecto a la instantánea anterior. La versión
+ * se mantiene si las métricas y la profundidad son idénticas. Tras sellarla
+ * no debe modificarse.
+ */
+void fee_snapshot_seal(FeeSnapshot *snapshot, const FeeSnapshot *previous);
+
+/**
+ * Indica si un consumidor que ya procesó `seen_version` debe procesar esta
+ */
+int fee_snapshot_changed(const FeeSnapshot *snapshot, uint64_t seen_version);
+
+#endif // FEE_SNAPSHOT_H
@@ -0,0 +1,154 @@
+#ifndef FEE_STATS_H
+#define FEE_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Niveles de tarifa seguidos por las estadísticas
+typedef enum {
+    FEE_TIER_FASTEST,
+    FEE_TIER_HALF_HOUR,
+    FEE_TIER_HOUR,
+    FEE_TIER_ECONOMY,
+    FEE_TIER_MINIMUM,
+    FEE_TIER_COUNT
+} FeeTier;
+
+// Percentiles aproximados mantenidos por cada serie
+typedef enum {
+    STAT_P50,
+    STAT_P90,
+    STAT_P99,
+    STAT_QUANTILE_COUNT
+} StatQuantile;
+
+// Muestra dentro de una ventana deslizante
+typedef struct {
+    double t;       // Marca de tiempo (segundos)
+    double v;       // Valor
+    uint64_t seq;   // Número de secuencia de la muestra
+} StatSample;
+
+// Cola doble sobre un buffer circular que crece por duplicación
+typedef struct {
+    StatSample *items;
+    size_t capacity;
+    size_t head;
+    size_t len;
+} StatDeque;
+
+// Estimador P² (Jain & Chlamtac) de un percentil
+typedef struct {
+    double p;          // Percentil objetivo (0..1)
+    double q[5];       // Alturas de los marcadores
+    double n[5];       // Posiciones actuales
+    double np[5];      // Posiciones deseadas
+    double dn[5];      // Incrementos de las posiciones deseadas
+    size_t count;      // Muestras observadas
+    double started_at; // Marca de tiempo de la primera muestra
+} P2Quantile;
+
+// Estadísticas móviles de una serie, actualizadas en O(1) por muestra
+typedef struct {
+    size_t window;      // Máximo de muestras en la ventana (0 = sin límite)
+    double max_age;     // Antigüedad máxima en segundos (0 = sin límite)
+    double alpha;       // Factor de suavizado de la EWMA
+
+    StatDeque samples;  // Muestras de la ventana en orden de llegada
+    StatDeque min_q;    // Cola monótona creciente para el mínimo
+    StatDeque max_q;    // Cola monótona decreciente para el máximo
+    uint64_t next_seq;
+
+    // Welford sobre la ventana
+    double mean;
+    double m2;
+
+    // Media móvil exponencial
+    double ewma;
+    int ewma_ready;
+
+    // Dos estimadores P² desfasados media ventana por percentil
+    P2Quantile quantiles[STAT_QUANTILE_COUNT][2];
+} RollingStats;
+
+// Resumen de una serie listo para mostrar
+typedef struct {
+    size_t count;
+    double last;
+    double min;
+    double max;
+    double mean;
+    double stddev;
+    double ewma;
+    double quantiles[STAT_QUANTILE_COUNT];
+} StatSummary;
+
+// Estadísticas de todos los niveles de tarifa
+typedef struct {
+    RollingStats tiers[FEE_TIER_COUNT];
+} FeeStats;
+
+/**
+ * Inicializa una serie de estadísticas móviles
+ *
+ * @param window Número máximo de muestras en la ventana (0 = sin límite)
+ * @param max_age Antigüedad máxima de las muestras en segundos (0 = sin límite)
+ * @param alpha Factor de suavizado de la EWMA (0..1]
+ */
+void rolling_stats_init(RollingStats *rs, size_t window, double max_age, double alpha);
+
+/**
+ * Libera la memoria de una serie
+ */
+void rolling_stats_free(RollingStats *rs);
+
+/**
+ * Vacía la ventana sin liberar memoria
+ */
+void rolling_stats_reset(RollingStats *rs);
+
+/**
+ * Añade una muestra y descarta las que salen de la ventana
+ */
+void rolling_stats_push(RollingStats *rs, double t, double v);
+
+/**
+ * Descarta las muestras anteriores a t sin añadir ninguna nueva
+ */
+void rolling_stats_evict_before(RollingStats *rs, double t);
+
+size_t rolling_stats_count(const RollingStats *rs);
+double rolling_stats_last(const RollingStats *rs);
+double rolling_stats_min(const RollingStats *rs);
+double rolling_stats_max(const RollingStats *rs);
+double rolling_stats_mean(const RollingStats *rs);
+double rolling_stats_variance(const RollingStats *rs);
+double rolling_stats_ewma(const RollingStats *rs);
+double rolling_stats_quantile(const RollingStats *rs, StatQuantile which);
+
+/**
+ * Rellena un resumen con todos los indicadores de la serie
+ */
+void rolling_stats_summary(const RollingStats *rs, StatSummary *out);
+
+/**
+ * Inicializa las estadísticas de todos los niveles con la misma ventana
+ */
+void fee_stats_init(FeeStats *stats, size_t window, double max_age, double alpha);
+
+/**
+ * Libera las estadísticas de todos los niveles
+ */
+void fee_stats_free(FeeStats *stats);
+
+/**
+ * Añade una muestra a los primeros `count` niveles
+ */
+void fee_stats_push(FeeStats *stats, double t, const double *values, int count);
+
+/**
+ * Máximo de la ventana entre los primeros `count` niveles (0 si están vacíos)
+ */
+double fee_stats_max(const FeeStats *stats, int count);
+
+#endif // FEE_STATS_H
@@ -0,0 +1,71 @@
+#ifndef FEE_STORE_H
+#define FEE_STORE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sqlite3.h>
+#include "fee_snapshot.h"
+
+// Filas por lote, antigüedad máxima de un lote y espera ante otro escritor
+#define FEE_STORE_BATCH_ROWS 12
+#define FEE_STORE_BATCH_SECONDS 300
+#define FEE_STORE_BUSY_TIMEOUT_MS 5000
+
+// Fila pendiente de escribir
+typedef struct {
+    int64_t timestamp;
+    double fastest_fee;
+    double half_hour_fee;
+    double hour_fee;
+    double economy_fee;
+    double minimum_fee;
+} FeeStoreRow;
+
+// Histórico de tarifas en SQLite compartido por la interfaz gráfica y la CLI.
+// Las filas se acumulan en memoria y cada lote se escribe en una transacción
+// corta (BEGIN, inserciones, COMMIT) con la sentencia preparada una sola vez,
+// de modo que cada refresco no cuesta un fsync y el bloqueo de escritura
+// nunca queda retenido entre refrescos.
+typedef struct {
+    sqlite3 *db;
+    sqlite3_stmt *insert;   // Sentencia de inserción preparada
+    FeeStoreRow rows[FEE_STORE_BATCH_ROWS];
+    int pending;            // Filas en memoria
+    time_t batch_started;   // Llegada de la primera fila pendiente
+} FeeStore;
+
+/**
+ * Abre (o crea) la base de datos en `path`, creando los directorios que
+ * falten. Devuelve 0 si falla; el error ya se ha escrito en stderr.
+ */
+int fee_store_open(FeeStore *store, const char *path);
+
+/**
+ * Ruta por defecto: ~/.local/share/btc-fee-tracker/data.db. Devuelve 0 si no
+ * cabe en el buffer o no se conoce el directorio personal.
+ */
+int fee_store_default_path(char *buffer, size_t size);
+
+/**
+ * Añade las tarifas de una instantánea al lote y lo escribe al llegar a
+ * FEE_STORE_BATCH_ROWS filas
+ */
+int fee_store_append(FeeStore *store, const FeeSnapshot *snapshot);
+
+/**
+ * Escribe el lote si tiene más de FEE_STORE_BATCH_SECONDS segundos. Se llama
+ * desde el temporizador del que lo usa, haya o no filas nuevas.
+ */
+int fee_store_flush_due(FeeStore *store, time_t now);
+
+/**
+ * Escribe las filas pendientes en una sola transacción
+ */
+int fee_store_flush(FeeStore *store);
+
+/**
+ * Escribe lo pendiente y cierra la base de datos
+ */
+void fee_store_close(FeeStore *store);
+
+#endif // FEE_STORE_H
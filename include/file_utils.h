@@ -0,0 +1,10 @@
+#ifndef FILE_UTILS_H
+#define FILE_UTILS_H
+
+/**
+ * Crea los directorios padre de una ruta (como mkdir -p). Devuelve 0 si
+ * alguno no se pudo crear; errno indica el motivo.
+ */
+int file_make_parent_dirs(const char *path);
+
+#endif // FILE_UTILS_H
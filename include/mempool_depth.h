@@ -0,0 +1,93 @@
+#ifndef MEMPOOL_DEPTH_H
+#define MEMPOOL_DEPTH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <cjson/cJSON.h>
+
+// Peso virtual máximo de un bloque (vbytes)
+#define MEMPOOL_BLOCK_VSIZE 1000000.0
+
+// Bloque proyectado de la mempool (/api/v1/fees/mempool-blocks)
+typedef struct {
+    double vsize;           // vbytes del bloque
+    double min_fee;         // Tarifa mínima incluida (sat/vB)
+    double median_fee;      // Tarifa mediana (sat/vB)
+    double total_fees;      // Comisiones totales (sat)
+    int64_t tx_count;       // Transacciones
+} MempoolProjectedBlock;
+
+// Profundidad de la mempool de un refresco. Inmutable una vez construida y
+// compartida por referencia entre instantáneas.
+typedef struct {
+    // Histograma ordenado por tarifa descendente: cum_vsize[i] son los vbytes
+    // con tarifa >= fee_rates[i]
+    double *fee_rates;
+    double *cum_vsize;
+    size_t bucket_count;
+
+    // Bloques proyectados y su peso acumulado
+    MempoolProjectedBlock *blocks;
+    double *block_cum_vsize;
+    size_t block_count;
+
+    atomic_int refcount;
+} MempoolDepth;
+
+/**
+ * Crea una profundidad vacía con una referencia
+ */
+MempoolDepth *mempool_depth_new(void);
+
+/**
+ * Añade una referencia y devuelve la misma profundidad
+ */
+MempoolDepth *mempool_depth_ref(MempoolDepth *depth);
+
+/**
+ * Quita una referencia; la última libera los arrays
+ */
+void mempool_depth_unref(MempoolDepth *depth);
+
+/**
+ * Carga el `fee_histogram` de /api/mempool: pares [tarifa, vsize] ordenados
+ * por tarifa descendente. Devuelve el número de tramos cargados.
+ */
+size_t mempool_depth_load_histogram(MempoolDepth *depth, const cJSON *histogram);
+
+/**
+ * Carga los bloques proyectados de /api/v1/fees/mempool-blocks.
+ * Devuelve el número de bloques cargados.
+ */
+size_t mempool_depth_load_blocks(MempoolDepth *depth, const cJSON *blocks);
+
+/**
+ * Indica si dos profundidades tienen el mismo contenido (comparación en bloque)
+ */
+int mempool_depth_equal(const MempoolDepth *a, const MempoolDepth *b);
+
+/**
+ * Vbytes totales del histograma
+ */
+double mempool_depth_total_vsize(const MempoolDepth *depth);
+
+/**
+ * Tarifa necesaria para quedar dentro de los primeros `vsize` vbytes de la
+ * mempool (búsqueda binaria). Devuelve 0 si toda la mempool cabe.
+ */
+double mempool_depth_fee_for_vsize(const MempoolDepth *depth, double vsize);
+
+/**
+ * Tarifa necesaria para confirmar en `target_blocks` bloques. Usa los
+ * bloques proyectados si los hay y, si no, el histograma. Devuelve 0 si
+ * la mempool se vacía antes del objetivo.
+ */
+double mempool_depth_fee_for_target(const MempoolDepth *depth, int target_blocks);
+
+/**
+ * Número de bloques que faltan para confirmar con la tarifa indicada
+ */
+int mempool_depth_blocks_for_fee(const MempoolDepth *depth, double fee_rate);
+
+#endif // MEMPOOL_DEPTH_H
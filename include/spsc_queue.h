@@ -0,0 +1,44 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Tamaño de línea de caché: productor y consumidor escriben en líneas distintas
+#define SPSC_CACHE_LINE 64
+
+// Cola sin bloqueos de un productor y un consumidor, de capacidad fija. Los
+// elementos se copian por valor, así que encolar no reserva memoria.
+typedef struct {
+    unsigned char *slots;
+    size_t element_size;
+    size_t capacity;    // Potencia de dos
+    
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t head;  // Siguiente a leer (consumidor)
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t tail;  // Siguiente a escribir (productor)
+} SpscQueue;
+
+/**
+ * Inicializa una cola para al menos `capacity` elementos de `element_size`
+ * bytes. Devuelve 0 si no hay memoria.
+ */
+int spsc_queue_init(SpscQueue *queue, size_t element_size, size_t capacity);
+
+/**
+ * Libera la memoria de la cola
+ */
+void spsc_queue_free(SpscQueue *queue);
+
+/**
+ * Copia un elemento al final de la cola (solo desde el hilo productor).
+ * Devuelve 0 si la cola está llena.
+ */
+int spsc_queue_push(SpscQueue *queue, const void *item);
+
+/**
+ * Saca el primer elemento de la cola (solo desde el hilo consumidor).
+ * Devuelve 0 si la cola está vacía.
+ */
+int spsc_queue_pop(SpscQueue *queue, void *item);
+
+#endif // SPSC_QUEUE_H
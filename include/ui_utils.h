@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include <time.h>
 #include "chart_utils.h"
+#include "fee_stats.h"
+#include "fee_snapshot.h"
 
 // Tema de la aplicación
 typedef enum {
@@ -27,12 +29,11 @@ typedef struct {
     GtkWidget *window;
     GtkWidget *main_box;
     GtkWidget *header_bar;
-    GtkWidget *header_box;     // Contenedor de la barra superior
     GtkWidget *content_box;    // Contenedor principal del contenido
     GtkWidget *drawing_area;
     GtkWidget *status_bar;
-    GtkWidget *stack;
     GtkCssProvider *css_provider;
+    guint css_idle_id;         // Carga de estilos pendiente
     GtkWidget *charts_box;     // Contenedor de gráficos
     GtkWidget *alerts_view;    // Vista de alertas
     
@@ -43,8 +44,8 @@ typedef struct {
     GtkWidget *theme_switch;
     GtkWidget *currency_combo;
     GtkWidget *notebook;
+    guint built_pages;         // Pestañas ya construidas (un bit por página)
     GtkWidget *config_box;
-    GtkWidget *footer_box;
     
     // Paneles
     GtkWidget *dashboard_panel;
@@ -57,12 +58,29 @@ typedef struct {
     GtkWidget *mempool_label;
     GtkWidget *fee_label;
     GtkWidget *fee_labels[5];  // Para las diferentes tarifas
+    GtkWidget *fee_stats_label; // Estadísticas móviles de la tarifa rápida
     GtkWidget *alerts_box;     // Contenedor de alertas
     
     // Gráficos
     ChartConfig *fee_chart;
     ChartConfig *price_chart;
     ChartConfig *mempool_chart;
+    ChartViewport *chart_viewport;  // Eje de tiempo común de los tres gráficos
+    
+    // Manejadores de las series de cada gráfico
+    ChartSeriesHandle fee_series[4];      // Rápido, media hora, 1 hora, económico
+    ChartSeriesHandle price_series;       // Precio USD
+    ChartSeriesHandle mempool_series[3];  // Transacciones, tamaño, tarifa media
+    
+    // Última instantánea mostrada
+    FeeSnapshot *snapshot;
+    uint64_t snapshot_version;
+    
+    // Velas de tarifa rápida y precio (intervalo 0 = vista de líneas)
+    GtkWidget *chart_view_combo;
+    CandleAggregator fee_candles;
+    CandleAggregator price_candles;
+    int64_t candle_interval;
     
     // Almacenamiento de datos
     GtkListStore *fee_history_store;
@@ -92,38 +110,32 @@ AppUI* ui_init(GtkApplication *app);
  */
 void ui_cleanup(AppUI *ui);
 
+/**
+ * Muestra una instantánea de datos. Si su versión ya se mostró no se
+ * actualiza nada; si no, se conserva una referencia y se actualizan
+ * tarifas, precio y mempool.
+ */
+void ui_update_snapshot(AppUI *ui, FeeSnapshot *snapshot);
+
 /**
  * Actualiza la información de tarifas en la interfaz
  */
-void ui_update_fee_info(
-    AppUI *ui, 
-    double fastest, 
-    double halfHour, 
-    double hour, 
-    double economy, 
-    double minimum
-);
+void ui_update_fee_info(AppUI *ui, const FeeSnapshot *snapshot);
+
+/**
+ * Actualiza las estadísticas móviles de la tarifa rápida
+ */
+void ui_update_fee_stats(AppUI *ui, const StatSummary *fastest);
 
 /**
  * Actualiza la información de precios en la interfaz
  */
-void ui_update_price_info(
-    AppUI *ui, 
-    double usd, 
-    double eur, 
-    double change24h
-);
+void ui_update_price_info(AppUI *ui, const FeeSnapshot *snapshot);
 
 /**
  * Actualiza la información del mempool en la interfaz
  */
-void ui_update_mempool_info(
-    AppUI *ui, 
-    int count, 
-    int size, 
-    double total_fee, 
-    double avg_fee
-);
+void ui_update_mempool_info(AppUI *ui, const FeeSnapshot *snapshot);
 
 /**
  * Muestra una notificación en el sistema
@@ -0,0 +1,214 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Alineación de todas las reservas
+#define ARENA_ALIGN 16
+
+// Arena asociada al hilo actual
+static _Thread_local Arena *bound_arena = NULL;
+
+// Reservas de los ganchos que no pudieron usar una arena
+static atomic_ulong hook_fallbacks = 0;
+
+static size_t align_up(size_t value) {
+    return (value + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+// Desplazamiento alineado del siguiente hueco libre de un bloque
+static size_t chunk_next_offset(const ArenaChunk *chunk) {
+    uintptr_t base = (uintptr_t)chunk->data;
+    uintptr_t next = (base + chunk->used + (ARENA_ALIGN - 1)) & ~(uintptr_t)(ARENA_ALIGN - 1);
+    return (size_t)(next - base);
+}
+
+static ArenaChunk *chunk_new(Arena *arena, size_t size) {
+    ArenaChunk *chunk = malloc(sizeof(ArenaChunk) + size + ARENA_ALIGN);
+    if (!chunk) return NULL;
+
+    chunk->next = NULL;
+    chunk->size = size + ARENA_ALIGN;
+    chunk->used = 0;
+    arena->stats.chunk_allocs++;
+    arena->stats.capacity += chunk->size;
+    return chunk;
+}
+
+void arena_init(Arena *arena, size_t chunk_size) {
+    memset(arena, 0, sizeof(*arena));
+    arena->chunk_size = chunk_size > 0 ? align_up(chunk_size) : 4096;
+}
+
+void arena_destroy(Arena *arena) {
+    if (!arena) return;
+
+    ArenaChunk *chunk = arena->chunks;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    if (bound_arena == arena) bound_arena = NULL;
+    memset(arena, 0, sizeof(*arena));
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    if (!arena) return NULL;
+    if (size == 0) size = 1;
+
+    // Buscar hueco en el bloque actual o en los siguientes ya reservados
+    ArenaChunk *chunk = arena->current ? arena->current : arena->chunks;
+    while (chunk) {
+        size_t offset = chunk_next_offset(chunk);
+        if (offset + size <= chunk->size) break;
+        chunk = chunk->next;
+        if (chunk) chunk->used = 0;
+    }
+
+    // Reservar un bloque nuevo al final de la lista
+    if (!chunk) {
+        size_t chunk_size = size > arena->chunk_size ? align_up(size) : arena->chunk_size;
+        chunk = chunk_new(arena, chunk_size);
+        if (!chunk) return NULL;
+
+        if (!arena->chunks) {
+            arena->chunks = chunk;
+        } else {
+            ArenaChunk *tail = arena->current ? arena->current : arena->chunks;
+            while (tail->next) tail = tail->next;
+            tail->next = chunk;
+        }
+    }
+
+    size_t offset = chunk_next_offset(chunk);
+    void *ptr = chunk->data + offset;
+    size_t before = chunk->used;
+    chunk->used = offset + size;
+
+    arena->current = chunk;
+    arena->last_alloc = ptr;
+    arena->stats.allocations++;
+    arena->stats.bytes_used += chunk->used - before;
+    if (arena->stats.bytes_used > arena->stats.high_water) {
+        arena->stats.high_water = arena->stats.bytes_used;
+    }
+    return ptr;
+}
+
+void *arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size) {
+    if (!ptr) return arena_alloc(arena, new_size);
+    if (new_size <= old_size) return ptr;
+
+    // Ampliar in situ si es la última reserva y cabe en el bloque
+    ArenaChunk *chunk = arena->current;
+    if (ptr == arena->last_alloc && chunk) {
+        size_t offset = (size_t)((unsigned char *)ptr - chunk->data);
+        if (offset + new_size <= chunk->size) {
+            size_t before = chunk->used;
+            chunk->used = offset + new_size;
+            arena->stats.bytes_used += chunk->used - before;
+            if (arena->stats.bytes_used > arena->stats.high_water) {
+                arena->stats.high_water = arena->stats.bytes_used;
+            }
+            return ptr;
+        }
+    }
+
+    void *copy = arena_alloc(arena, new_size);
+    if (copy) memcpy(copy, ptr, old_size);
+    return copy;
+}
+
+int arena_contains(const Arena *arena, const void *ptr) {
+    if (!arena || !ptr) return 0;
+
+    const unsigned char *p = ptr;
+    for (const ArenaChunk *chunk = arena->chunks; chunk; chunk = chunk->next) {
+        if (p >= chunk->data && p < chunk->data + chunk->size) return 1;
+    }
+    return 0;
+}
+
+void arena_reset(Arena *arena) {
+    if (!arena) return;
+
+    // Un ciclo que necesitó varios bloques se consolida en uno solo
+    if (arena->chunks && arena->chunks->next) {
+        size_t total = 0;
+        ArenaChunk *chunk = arena->chunks;
+        while (chunk) {
+            ArenaChunk *next = chunk->next;
+            total += chunk->size;
+            arena->stats.capacity -= chunk->size;
+            arena->stats.chunk_frees++;
+            free(chunk);
+            chunk = next;
+        }
+        arena->chunks = chunk_new(arena, align_up(total));
+    }
+
+    if (arena->chunks) arena->chunks->used = 0;
+    arena->current = arena->chunks;
+    arena->last_alloc = NULL;
+    arena->stats.bytes_used = 0;
+    arena->stats.resets++;
+}
+
+void arena_get_stats(const Arena *arena, ArenaStats *stats) {
+    *stats = arena->stats;
+}
+
+void arena_bind(Arena *arena) {
+    bound_arena = arena;
+}
+
+void *arena_hook_malloc(size_t size) {
+    if (bound_arena) {
+        void *ptr = arena_alloc(bound_arena, size);
+        if (ptr) return ptr;
+    }
+    atomic_fetch_add(&hook_fallbacks, 1);
+    return malloc(size);
+}
+
+void arena_hook_free(void *ptr) {
+    if (!ptr) return;
+    // La memoria de la arena se recupera en bloque con arena_reset()
+    if (bound_arena && arena_contains(bound_arena, ptr)) return;
+    free(ptr);
+}
+
+unsigned long arena_hook_fallback_count(void) {
+    return atomic_load(&hook_fallbacks);
+}
+
+void arena_buffer_init(ArenaBuffer *buf, Arena *arena, size_t initial_capacity) {
+    buf->arena = arena;
+    buf->len = 0;
+    buf->capacity = initial_capacity > 0 ? initial_capacity : 256;
+    buf->data = arena_alloc(arena, buf->capacity);
+    if (buf->data) {
+        buf->data[0] = '\0';
+    } else {
+        buf->capacity = 0;
+    }
+}
+
+int arena_buffer_append(ArenaBuffer *buf, const void *data, size_t len) {
+    if (buf->len + len + 1 > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 256;
+        while (buf->len + len + 1 > capacity) capacity *= 2;
+
+        char *grown = arena_realloc(buf->arena, buf->data, buf->capacity, capacity);
+        if (!grown) return 0;
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+    return 1;
+}
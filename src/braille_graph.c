@@ -0,0 +1,194 @@
+#include "braille_graph.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Bit de cada subpíxel dentro del patrón braille, por [fila][columna]
+static const uint8_t DOT_BITS[BRAILLE_CELL_HEIGHT][BRAILLE_CELL_WIDTH] = {
+    { 0x01, 0x08 },
+    { 0x02, 0x10 },
+    { 0x04, 0x20 },
+    { 0x40, 0x80 }
+};
+
+int braille_canvas_resize(BrailleCanvas *canvas, int cols, int rows) {
+    size_t cells = (size_t)(cols > 0 ? cols : 0) * (size_t)(rows > 0 ? rows : 0);
+    
+    // Un solo bloque para los cuatro planos
+    uint8_t *block = NULL;
+    if (cells > 0) {
+        block = calloc(4, cells);
+        if (!block) return 0;
+    }
+    
+    free(canvas->dots);
+    canvas->dots = block;
+    canvas->colors = block ? block + cells : NULL;
+    canvas->drawn_dots = block ? block + 2 * cells : NULL;
+    canvas->drawn_colors = block ? block + 3 * cells : NULL;
+    canvas->cols = cells ? cols : 0;
+    canvas->rows = cells ? rows : 0;
+    canvas->valid = 0;
+    return 1;
+}
+
+void braille_canvas_free(BrailleCanvas *canvas) {
+    free(canvas->dots);
+    memset(canvas, 0, sizeof(*canvas));
+}
+
+void braille_canvas_clear(BrailleCanvas *canvas) {
+    size_t cells = (size_t)canvas->cols * canvas->rows;
+    if (cells == 0) return;
+    memset(canvas->dots, 0, cells);
+    memset(canvas->colors, 0, cells);
+}
+
+void braille_canvas_clear_cells(BrailleCanvas *canvas, int col_from, int col_to) {
+    if (col_from < 0) col_from = 0;
+    if (col_to > canvas->cols) col_to = canvas->cols;
+    if (col_from >= col_to) return;
+    
+    for (int row = 0; row < canvas->rows; row++) {
+        size_t index = (size_t)row * canvas->cols + col_from;
+        memset(canvas->dots + index, 0, (size_t)(col_to - col_from));
+        memset(canvas->colors + index, 0, (size_t)(col_to - col_from));
+    }
+}
+
+void braille_canvas_invalidate(BrailleCanvas *canvas) {
+    canvas->valid = 0;
+}
+
+void braille_canvas_set(BrailleCanvas *canvas, int px, int py, uint8_t color) {
+    if (px < 0 || py < 0) return;
+    int col = px / BRAILLE_CELL_WIDTH;
+    int row = py / BRAILLE_CELL_HEIGHT;
+    if (col >= canvas->cols || row >= canvas->rows) return;
+    
+    size_t index = (size_t)row * canvas->cols + col;
+    canvas->dots[index] |= DOT_BITS[py % BRAILLE_CELL_HEIGHT][px % BRAILLE_CELL_WIDTH];
+    // Con varias series en una celda queda el color mayor, así el resultado
+    // no depende del orden en que se tracen
+    if (color > canvas->colors[index]) canvas->colors[index] = color;
+}
+
+int braille_canvas_flush(BrailleCanvas *canvas, BrailleCellFunc func, void *user_data) {
+    int sent = 0;
+    
+    for (int row = 0; row < canvas->rows; row++) {
+        for (int col = 0; col < canvas->cols; col++) {
+            size_t index = (size_t)row * canvas->cols + col;
+            uint8_t dots = canvas->dots[index];
+            uint8_t color = dots ? canvas->colors[index] : 0;
+            
+            if (canvas->valid && dots == canvas->drawn_dots[index] &&
+                color == canvas->drawn_colors[index]) {
+                continue;
+            }
+            
+            // U+2800 + patrón en UTF-8
+            char utf8[4] = "";
+            if (dots) {
+                utf8[0] = (char)0xE2;
+                utf8[1] = (char)(0xA0 | (dots >> 6));
+                utf8[2] = (char)(0x80 | (dots & 0x3F));
+                utf8[3] = '\0';
+            }
+            func(user_data, col, row, utf8, color);
+            
+            canvas->drawn_dots[index] = dots;
+            canvas->drawn_colors[index] = color;
+            sent++;
+        }
+    }
+    
+    canvas->valid = 1;
+    return sent;
+}
+
+// Línea vertical en una columna de subpíxeles
+static void plot_vline(BraillePlot *plot, int px, int from, int to) {
+    if (from > to) {
+        int tmp = from;
+        from = to;
+        to = tmp;
+    }
+    for (int py = from; py <= to; py++) {
+        braille_canvas_set(plot->canvas, px, py, plot->color);
+    }
+}
+
+// Segmento entre dos subpíxeles (Bresenham) para unir columnas separadas
+static void plot_line(BraillePlot *plot, int x0, int y0, int x1, int y1) {
+    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    
+    while (1) {
+        braille_canvas_set(plot->canvas, x0, y0, plot->color);
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+// Vuelca la columna en curso: su rango completo y la unión con la anterior
+static void plot_flush_column(BraillePlot *plot) {
+    if (plot->column < 0) return;
+    
+    if (plot->prev_column >= 0) {
+        plot_line(plot, plot->prev_column, plot->prev_last, plot->column, plot->first);
+    }
+    plot_vline(plot, plot->column, plot->low, plot->high);
+    
+    plot->prev_column = plot->column;
+    plot->prev_last = plot->last;
+}
+
+void braille_plot_begin(BraillePlot *plot, BrailleCanvas *canvas, double x_min, double x_max,
+                        double y_min, double y_max, uint8_t color) {
+    int width = canvas->cols * BRAILLE_CELL_WIDTH;
+    int height = canvas->rows * BRAILLE_CELL_HEIGHT;
+    
+    plot->canvas = canvas;
+    plot->color = color;
+    plot->x_min = x_min;
+    plot->x_scale = x_max > x_min ? (width - 1) / (x_max - x_min) : 0;
+    plot->y_max = y_max;
+    plot->y_scale = y_max > y_min ? (height - 1) / (y_max - y_min) : 0;
+    plot->column = -1;
+    plot->prev_column = -1;
+}
+
+void braille_plot_point(BraillePlot *plot, double x, double y) {
+    int px = (int)((x - plot->x_min) * plot->x_scale + 0.5);
+    int py = (int)((plot->y_max - y) * plot->y_scale + 0.5);
+    
+    // Los valores fuera de rango quedan en el borde
+    int height = plot->canvas->rows * BRAILLE_CELL_HEIGHT;
+    if (py < 0) py = 0;
+    if (py >= height) py = height - 1;
+    
+    if (px != plot->column) {
+        plot_flush_column(plot);
+        plot->column = px;
+        plot->first = plot->last = plot->low = plot->high = py;
+        return;
+    }
+    
+    plot->last = py;
+    if (py < plot->low) plot->low = py;
+    if (py > plot->high) plot->high = py;
+}
+
+void braille_plot_end(BraillePlot *plot) {
+    plot_flush_column(plot);
+    plot->column = -1;
+}
@@ -7,32 +7,36 @@
 #include <time.h>
 #include <math.h>
 #include <libnotify/notify.h>
-#include <sqlite3.h>
 #include <sys/stat.h>
 #include <glib/gstdio.h>
 #include <glib/gprintf.h>
 #include "chart_utils.h"
 #include "ui_utils.h"
+#include "fee_stats.h"
+#include "arena.h"
+#include "fee_snapshot.h"
+#include "fee_store.h"
+
+// Rolling statistics window: 24 h of samples at the default 5 minute interval
+#define FEE_STATS_WINDOW 288
+#define FEE_STATS_EWMA_ALPHA 0.3
+
+// Per-refresh arena: one chunk holds all responses and parse trees of a cycle
+#define FETCH_ARENA_CHUNK (64 * 1024)
+#define RESPONSE_INITIAL_CAPACITY (16 * 1024)
 
 // Forward declarations
 static gboolean update_data(gpointer user_data);
 static gpointer update_data_thread(gpointer user_data);
-static void update_ui(gpointer user_data);
+static gboolean update_ui(gpointer user_data);
 
 // Global application data structure
 typedef struct {
-    double fastest_fee;
-    double half_hour_fee;
-    double hour_fee;
-    double economy_fee;
-    double minimum_fee;
-    double btc_price_usd;
-    double btc_price_eur;
-    double price_change_24h;
-    int mempool_tx_count;
-    int mempool_size_bytes;
-    double mempool_total_fee;
-    double mempool_avg_fee;
+    // Latest published snapshot (guarded by data_mutex)
+    FeeSnapshot *snapshot;
+    
+    // Rolling statistics per fee tier
+    FeeStats fee_stats;
     
     // UI components
     AppUI *ui;
@@ -45,8 +49,12 @@ typedef struct {
     gboolean is_updating;
     pthread_t update_thread;
     
-    // Database
-    sqlite3 *db;
+    // Database (batched inserts, shared with the CLI collector)
+    FeeStore store;
+    
+    // Network: reused handle and per-cycle arena for transient allocations
+    CURL *curl;
+    Arena fetch_arena;
     
     // Mutex for thread safety
     pthread_mutex_t data_mutex;
@@ -57,181 +65,110 @@ static AppData app_data;
 // Callback for CURL to write response
 static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
-    GString *response = (GString *)userp;
-    g_string_append_len(response, contents, realsize);
+    ArenaBuffer *response = (ArenaBuffer *)userp;
+    if (!arena_buffer_append(response, contents, realsize)) return 0;
     return realsize;
 }
 
-// Database initialization
-gboolean init_database() {
-    char *home_dir = g_get_home_dir();
-    char *db_path = g_build_filename(home_dir, ".local", "share", "btc-fee-tracker", "data.db", NULL);
-    
-    // Create directory if it doesn't exist
-    char *db_dir = g_path_get_dirname(db_path);
-    if (g_mkdir_with_parents(db_dir, 0755) == -1) {
-        g_warning("Failed to create database directory: %s", db_dir);
-        g_free(db_dir);
-        g_free(db_path);
-        return FALSE;
+// Perform a GET into an arena-backed buffer, reusing the shared CURL handle
+static gboolean http_get(const char *url, ArenaBuffer *response, const char *what) {
+    if (!app_data.curl) {
+        app_data.curl = curl_easy_init();
+        if (!app_data.curl) {
+            g_warning("Failed to initialize CURL");
+            return FALSE;
+        }
     }
-    g_free(db_dir);
     
-    // Open database
-    if (sqlite3_open(db_path, &app_data.db) != SQLITE_OK) {
-        g_warning("Failed to open database: %s", sqlite3_errmsg(app_data.db));
-        g_free(db_path);
+    arena_buffer_init(response, &app_data.fetch_arena, RESPONSE_INITIAL_CAPACITY);
+    if (!response->data) {
+        g_warning("Failed to allocate response buffer for %s", what);
         return FALSE;
     }
     
-    // Create tables if they don't exist
-    const char *sql = "CREATE TABLE IF NOT EXISTS fee_history ("
-                     "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-                     "timestamp INTEGER NOT NULL,"
-                     "fastest_fee REAL NOT NULL,"
-                     "half_hour_fee REAL NOT NULL,"
-                     "hour_fee REAL NOT NULL,"
-                     "economy_fee REAL NOT NULL,"
-                     "minimum_fee REAL NOT NULL"
-                     ");";
-                     
-    char *err_msg = NULL;
-    if (sqlite3_exec(app_data.db, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
-        g_warning("Failed to create table: %s", err_msg);
-        sqlite3_free(err_msg);
-        g_free(db_path);
+    curl_easy_setopt(app_data.curl, CURLOPT_URL, url);
+    curl_easy_setopt(app_data.curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(app_data.curl, CURLOPT_WRITEDATA, response);
+    curl_easy_setopt(app_data.curl, CURLOPT_USERAGENT, "BitcoinFeeTracker/1.0");
+    
+    CURLcode res = curl_easy_perform(app_data.curl);
+    if (res != CURLE_OK) {
+        g_warning("Failed to fetch %s: %s", what, curl_easy_strerror(res));
         return FALSE;
     }
     
-    g_free(db_path);
     return TRUE;
 }
 
-// Save fee data to database
-gboolean save_fee_data_to_db() {
-    if (!app_data.db) return FALSE;
-    
-    const char *sql = "INSERT INTO fee_history (timestamp, fastest_fee, half_hour_fee, hour_fee, economy_fee, minimum_fee) "
-                     "VALUES (?, ?, ?, ?, ?, ?);";
-    
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(app_data.db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-        g_warning("Failed to prepare statement: %s", sqlite3_errmsg(app_data.db));
-        return FALSE;
-    }
-    
-    time_t now = time(NULL);
-    sqlite3_bind_int64(stmt, 1, now);
-    sqlite3_bind_double(stmt, 2, app_data.fastest_fee);
-    sqlite3_bind_double(stmt, 3, app_data.half_hour_fee);
-    sqlite3_bind_double(stmt, 4, app_data.hour_fee);
-    sqlite3_bind_double(stmt, 5, app_data.economy_fee);
-    sqlite3_bind_double(stmt, 6, app_data.minimum_fee);
-    
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        g_warning("Failed to insert data: %s", sqlite3_errmsg(app_data.db));
-        sqlite3_finalize(stmt);
-        return FALSE;
+// Database initialization
+gboolean init_database() {
+    char *db_path = g_build_filename(g_get_home_dir(), ".local", "share", "btc-fee-tracker", "data.db", NULL);
+    gboolean ok = fee_store_open(&app_data.store, db_path);
+    if (!ok) {
+        g_warning("Failed to open database: %s", db_path);
     }
-    
-    sqlite3_finalize(stmt);
-    return TRUE;
+    g_free(db_path);
+    return ok;
+}
+
+// Save fee data to database (buffered and written in batches by the store)
+gboolean save_fee_data_to_db(const FeeSnapshot *snapshot) {
+    return fee_store_append(&app_data.store, snapshot);
 }
 
 // Fetch current fee data from mempool.space API
-gboolean fetch_fee_data() {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        g_warning("Failed to initialize CURL");
-        return FALSE;
-    }
-    
-    GString *response = g_string_new("");
-    curl_easy_setopt(curl, CURLOPT_URL, "https://mempool.space/api/v1/fees/recommended");
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "BitcoinFeeTracker/1.0");
-    
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        g_warning("Failed to fetch fee data: %s", curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
-        g_string_free(response, TRUE);
+gboolean fetch_fee_data(FeeSnapshot *snapshot) {
+    ArenaBuffer response;
+    if (!http_get("https://mempool.space/api/v1/fees/recommended", &response, "fee data")) {
         return FALSE;
     }
     
-    // Parse JSON response
-    cJSON *json = cJSON_Parse(response->str);
+    // Parse JSON response (the tree is allocated from the cycle arena)
+    cJSON *json = cJSON_Parse(response.data);
     if (!json) {
         g_warning("Failed to parse JSON response");
-        curl_easy_cleanup(curl);
-        g_string_free(response, TRUE);
         return FALSE;
     }
     
-    // Extract fee data
-    pthread_mutex_lock(&app_data.data_mutex);
+    // Extract fee data into the snapshot being built (owned by this thread)
+    FeeMetrics *m = &snapshot->metrics;
     
     cJSON *item = cJSON_GetObjectItemCaseSensitive(json, "fastestFee");
-    if (cJSON_IsNumber(item)) app_data.fastest_fee = item->valuedouble;
+    if (cJSON_IsNumber(item)) m->fastest_fee = item->valuedouble;
     
     item = cJSON_GetObjectItemCaseSensitive(json, "halfHourFee");
-    if (cJSON_IsNumber(item)) app_data.half_hour_fee = item->valuedouble;
+    if (cJSON_IsNumber(item)) m->half_hour_fee = item->valuedouble;
     
     item = cJSON_GetObjectItemCaseSensitive(json, "hourFee");
-    if (cJSON_IsNumber(item)) app_data.hour_fee = item->valuedouble;
+    if (cJSON_IsNumber(item)) m->hour_fee = item->valuedouble;
     
     item = cJSON_GetObjectItemCaseSensitive(json, "economyFee");
-    if (cJSON_IsNumber(item)) app_data.economy_fee = item->valuedouble;
+    if (cJSON_IsNumber(item)) m->economy_fee = item->valuedouble;
     
     item = cJSON_GetObjectItemCaseSensitive(json, "minimumFee");
-    if (cJSON_IsNumber(item)) app_data.minimum_fee = item->valuedouble;
-    
-    pthread_mutex_unlock(&app_data.data_mutex);
-    
-    // Save to database
-    save_fee_data_to_db();
+    if (cJSON_IsNumber(item)) m->minimum_fee = item->valuedouble;
     
     cJSON_Delete(json);
-    curl_easy_cleanup(curl);
-    g_string_free(response, TRUE);
     
     return TRUE;
 }
 
 // Fetch Bitcoin price data
-gboolean fetch_btc_price() {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        g_warning("Failed to initialize CURL");
-        return FALSE;
-    }
-    
-    GString *response = g_string_new("");
-    curl_easy_setopt(curl, CURLOPT_URL, "https://api.coingecko.com/api/v3/simple/price?ids=bitcoin&vs_currencies=usd,eur&include_24hr_change=true");
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "BitcoinFeeTracker/1.0");
-    
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        g_warning("Failed to fetch price data: %s", curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
-        g_string_free(response, TRUE);
+gboolean fetch_btc_price(FeeSnapshot *snapshot) {
+    ArenaBuffer response;
+    if (!http_get("https://api.coingecko.com/api/v3/simple/price?ids=bitcoin&vs_currencies=usd,eur&include_24hr_change=true", &response, "price data")) {
         return FALSE;
     }
     
-    // Parse JSON response
-    cJSON *json = cJSON_Parse(response->str);
+    // Parse JSON response (the tree is allocated from the cycle arena)
+    cJSON *json = cJSON_Parse(response.data);
     if (!json) {
         g_warning("Failed to parse JSON response");
-        curl_easy_cleanup(curl);
-        g_string_free(response, TRUE);
         return FALSE;
     }
     
     // Extract price data
-    pthread_mutex_lock(&app_data.data_mutex);
+    FeeMetrics *m = &snapshot->metrics;
     
     cJSON *bitcoin = cJSON_GetObjectItemCaseSensitive(json, "bitcoin");
     if (bitcoin) {
@@ -239,75 +176,82 @@ gboolean fetch_btc_price() {
         cJSON *eur = cJSON_GetObjectItemCaseSensitive(bitcoin, "eur");
         cJSON *change = cJSON_GetObjectItemCaseSensitive(bitcoin, "usd_24h_change");
         
-        if (cJSON_IsNumber(usd)) app_data.btc_price_usd = usd->valuedouble;
-        if (cJSON_IsNumber(eur)) app_data.btc_price_eur = eur->valuedouble;
-        if (cJSON_IsNumber(change)) app_data.price_change_24h = change->valuedouble;
+        if (cJSON_IsNumber(usd)) m->btc_price_usd = usd->valuedouble;
+        if (cJSON_IsNumber(eur)) m->btc_price_eur = eur->valuedouble;
+        if (cJSON_IsNumber(change)) m->price_change_24h = change->valuedouble;
     }
     
-    pthread_mutex_unlock(&app_data.data_mutex);
-    
     cJSON_Delete(json);
-    curl_easy_cleanup(curl);
-    g_string_free(response, TRUE);
     
     return TRUE;
 }
 
-// Fetch mempool data
-gboolean fetch_mempool_data() {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        g_warning("Failed to initialize CURL");
+// Fetch projected mempool blocks into a depth table
+static gboolean fetch_mempool_blocks(MempoolDepth *depth) {
+    ArenaBuffer response;
+    if (!http_get("https://mempool.space/api/v1/fees/mempool-blocks", &response, "mempool blocks")) {
         return FALSE;
     }
     
-    GString *response = g_string_new("");
-    curl_easy_setopt(curl, CURLOPT_URL, "https://mempool.space/api/mempool");
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "BitcoinFeeTracker/1.0");
+    cJSON *json = cJSON_Parse(response.data);
+    if (!json) {
+        g_warning("Failed to parse mempool blocks response");
+        return FALSE;
+    }
     
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        g_warning("Failed to fetch mempool data: %s", curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
-        g_string_free(response, TRUE);
+    gboolean loaded = mempool_depth_load_blocks(depth, json) > 0;
+    cJSON_Delete(json);
+    return loaded;
+}
+
+// Fetch mempool data
+gboolean fetch_mempool_data(FeeSnapshot *snapshot) {
+    ArenaBuffer response;
+    if (!http_get("https://mempool.space/api/mempool", &response, "mempool data")) {
         return FALSE;
     }
     
-    // Parse JSON response
-    cJSON *json = cJSON_Parse(response->str);
+    // Parse JSON response (the tree is allocated from the cycle arena)
+    cJSON *json = cJSON_Parse(response.data);
     if (!json) {
         g_warning("Failed to parse JSON response");
-        curl_easy_cleanup(curl);
-        g_string_free(response, TRUE);
         return FALSE;
     }
     
     // Extract mempool data
-    pthread_mutex_lock(&app_data.data_mutex);
+    FeeMetrics *m = &snapshot->metrics;
     
     cJSON *item = cJSON_GetObjectItemCaseSensitive(json, "count");
-    if (cJSON_IsNumber(item)) app_data.mempool_tx_count = item->valueint;
+    if (cJSON_IsNumber(item)) m->mempool_tx_count = (int64_t)item->valuedouble;
     
     item = cJSON_GetObjectItemCaseSensitive(json, "vsize");
-    if (cJSON_IsNumber(item)) app_data.mempool_size_bytes = item->valueint;
+    if (cJSON_IsNumber(item)) m->mempool_vsize = (int64_t)item->valuedouble;
     
     item = cJSON_GetObjectItemCaseSensitive(json, "total_fee");
-    if (cJSON_IsNumber(item)) app_data.mempool_total_fee = item->valuedouble;
+    if (cJSON_IsNumber(item)) m->mempool_total_fee = item->valuedouble;
     
     // Calculate average fee per vbyte
-    if (app_data.mempool_size_bytes > 0) {
-        app_data.mempool_avg_fee = (app_data.mempool_total_fee * 100000000) / app_data.mempool_size_bytes;
+    if (m->mempool_vsize > 0) {
+        m->mempool_avg_fee = (m->mempool_total_fee * 100000000) / m->mempool_vsize;
     } else {
-        app_data.mempool_avg_fee = 0;
+        m->mempool_avg_fee = 0;
     }
     
-    pthread_mutex_unlock(&app_data.data_mutex);
+    // Keep the fee histogram and projected blocks for local target queries
+    MempoolDepth *depth = mempool_depth_new();
+    if (depth) {
+        gboolean loaded = mempool_depth_load_histogram(depth,
+                cJSON_GetObjectItemCaseSensitive(json, "fee_histogram")) > 0;
+        loaded = fetch_mempool_blocks(depth) || loaded;
+        
+        if (loaded) {
+            fee_snapshot_set_depth(snapshot, depth);
+        } else {
+            mempool_depth_unref(depth);
+        }
+    }
     
     cJSON_Delete(json);
-    curl_easy_cleanup(curl);
-    g_string_free(response, TRUE);
     
     return TRUE;
 }
@@ -332,28 +276,40 @@ void show_notification(const gchar *title, const gchar *message, const gchar *ic
 }
 
 // Check and trigger alerts
-void check_alerts() {
-    // Example alert: Notify if fee drops below 10 sat/vB
-    if (app_data.fastest_fee < 10.0) {
+void check_alerts(const FeeSnapshot *snapshot) {
+    // Each snapshot version is checked once
+    static uint64_t checked_version = 0;
+    if (!fee_snapshot_changed(snapshot, checked_version)) return;
+    checked_version = snapshot->version;
+    const FeeMetrics *m = &snapshot->metrics;
+    
+    // Example alert: Notify if the smoothed fee drops below 10 sat/vB
+    pthread_mutex_lock(&app_data.data_mutex);
+    const RollingStats *fastest = &app_data.fee_stats.tiers[FEE_TIER_FASTEST];
+    gboolean have_fee = rolling_stats_count(fastest) > 0;
+    double smoothed_fee = rolling_stats_ewma(fastest);
+    pthread_mutex_unlock(&app_data.data_mutex);
+    
+    if (have_fee && smoothed_fee < 10.0) {
         char message[256];
-        snprintf(message, sizeof(message), "¡La tarifa ha bajado a %.1f sat/vB!", app_data.fastest_fee);
+        snprintf(message, sizeof(message), "¡La tarifa ha bajado a %.1f sat/vB!", smoothed_fee);
         show_notification("¡Oferta de tarifas bajas!", message, "dialog-information");
     }
     
     // Example alert: Notify if price changes more than 2% in 24h
-    if (fabs(app_data.price_change_24h) > 2.0) {
-        const char *direction = app_data.price_change_24h > 0 ? "subido" : "bajado";
+    if (fabs(m->price_change_24h) > 2.0) {
+        const char *direction = m->price_change_24h > 0 ? "subido" : "bajado";
         char message[256];
         snprintf(message, sizeof(message), "El precio ha %s un %.1f%% en 24h", 
-                direction, fabs(app_data.price_change_24h));
+                direction, fabs(m->price_change_24h));
         show_notification("Cambio significativo de precio", message, "stock_market-up");
     }
     
     // Example alert: Notify if mempool is congested
-    if (app_data.mempool_tx_count > 50000) {
+    if (m->mempool_tx_count > 50000) {
         char message[256];
-        snprintf(message, sizeof(message), "¡La mempool está congestionada con %d transacciones!", 
-                app_data.mempool_tx_count);
+        snprintf(message, sizeof(message), "¡La mempool está congestionada con %lld transacciones!", 
+                (long long)m->mempool_tx_count);
         show_notification("Congestión en la Mempool", message, "dialog-warning");
     }
 }
@@ -373,6 +329,12 @@ static void init_app_data() {
     pthread_mutex_init(&app_data.data_mutex, NULL);
     app_data.update_interval = 300; // 5 minutes
     app_data.is_updating = FALSE;
+    fee_stats_init(&app_data.fee_stats, FEE_STATS_WINDOW, 0, FEE_STATS_EWMA_ALPHA);
+    
+    // Route cJSON allocations through the per-cycle arena when one is bound
+    arena_init(&app_data.fetch_arena, FETCH_ARENA_CHUNK);
+    cJSON_Hooks hooks = { arena_hook_malloc, arena_hook_free };
+    cJSON_InitHooks(&hooks);
     
     // Initialize libnotify
     if (!notify_init("Bitcoin Fee Tracker")) {
@@ -391,61 +353,124 @@ static void cleanup_app_data() {
         g_source_remove(app_data.update_timeout_id);
     }
     
-    if (app_data.db) {
-        sqlite3_close(app_data.db);
-        app_data.db = NULL;
-    }
+    // Writes the rows still pending in the batch
+    fee_store_close(&app_data.store);
+    
+    fee_stats_free(&app_data.fee_stats);
+    fee_snapshot_unref(app_data.snapshot);
+    app_data.snapshot = NULL;
     
+    if (app_data.curl) {
+        curl_easy_cleanup(app_data.curl);
+        app_data.curl = NULL;
+    }
+    arena_destroy(&app_data.fetch_arena);
     pthread_mutex_destroy(&app_data.data_mutex);
     notify_uninit();
     curl_global_cleanup();
 }
 
-// Update the UI with the latest data
-static void update_ui(gpointer user_data) {
-    (void)user_data; // Unused parameter
-    if (!app_data.ui) return;
+// Update the UI with a published snapshot (runs in the main thread)
+static gboolean update_ui(gpointer user_data) {
+    FeeSnapshot *snapshot = (FeeSnapshot *)user_data;
     
-    pthread_mutex_lock(&app_data.data_mutex);
+    if (app_data.ui) {
+        // Fee, price and mempool views skip versions they have already shown
+        ui_update_snapshot(app_data.ui, snapshot);
+        
+        // Update rolling statistics labels
+        StatSummary fastest_summary;
+        pthread_mutex_lock(&app_data.data_mutex);
+        rolling_stats_summary(&app_data.fee_stats.tiers[FEE_TIER_FASTEST], &fastest_summary);
+        pthread_mutex_unlock(&app_data.data_mutex);
+        ui_update_fee_stats(app_data.ui, &fastest_summary);
+        
+        // Check for alerts
+        check_alerts(snapshot);
+    }
     
-    // Update fee information
-    ui_update_fee_info(app_data.ui, 
-                      app_data.fastest_fee,
-                      app_data.half_hour_fee,
-                      app_data.hour_fee,
-                      app_data.economy_fee,
-                      app_data.minimum_fee);
-    
-    // Update price information
-    ui_update_price_info(app_data.ui,
-                        app_data.btc_price_usd,
-                        app_data.btc_price_eur,
-                        app_data.price_change_24h);
-    
-    // Update mempool information
-    ui_update_mempool_info(app_data.ui,
-                          app_data.mempool_tx_count,
-                          app_data.mempool_size_bytes,
-                          app_data.mempool_total_fee,
-                          app_data.mempool_avg_fee);
+    fee_snapshot_unref(snapshot);
+    return G_SOURCE_REMOVE;
+}
+
+// Publish a sealed snapshot to every consumer
+static void publish_snapshot(FeeSnapshot *snapshot, gboolean have_fees) {
+    pthread_mutex_lock(&app_data.data_mutex);
+    gboolean changed = !app_data.snapshot || app_data.snapshot->version != snapshot->version;
+    
+    // Feed the rolling statistics (O(1) per tier)
+    if (changed && have_fees) {
+        const FeeMetrics *m = &snapshot->metrics;
+        double values[FEE_TIER_COUNT] = {
+            [FEE_TIER_FASTEST] = m->fastest_fee,
+            [FEE_TIER_HALF_HOUR] = m->half_hour_fee,
+            [FEE_TIER_HOUR] = m->hour_fee,
+            [FEE_TIER_ECONOMY] = m->economy_fee,
+            [FEE_TIER_MINIMUM] = m->minimum_fee
+        };
+        fee_stats_push(&app_data.fee_stats, (double)snapshot->timestamp, values, FEE_TIER_COUNT);
+    }
     
+    // The latest snapshot always becomes current so sequence and latency stay fresh
+    FeeSnapshot *old = app_data.snapshot;
+    app_data.snapshot = fee_snapshot_ref(snapshot);
     pthread_mutex_unlock(&app_data.data_mutex);
+    fee_snapshot_unref(old);
     
-    // Check for alerts
-    check_alerts();
+    // Unchanged snapshots stop here
+    if (!changed) return;
+    
+    // Save to database
+    if (have_fees) {
+        save_fee_data_to_db(snapshot);
+    }
+    
+    // Update UI in the main thread
+    g_idle_add(update_ui, fee_snapshot_ref(snapshot));
 }
 
 // Thread function to fetch data
 static gpointer update_data_thread(gpointer user_data) {
     (void)user_data; // Unused parameter
     
-    // Fetch data from APIs
-    fetch_fee_data();
-    fetch_btc_price();
-    fetch_mempool_data();
+    // Start from the previous snapshot so a failed endpoint keeps its last values
+    pthread_mutex_lock(&app_data.data_mutex);
+    FeeSnapshot *previous = fee_snapshot_ref(app_data.snapshot);
+    pthread_mutex_unlock(&app_data.data_mutex);
     
-    // Update UI in the main thread
-    g_idle_add((GSourceFunc)update_ui, NULL);
+    FeeSnapshot *snapshot = fee_snapshot_new(previous);
+    if (!snapshot) {
+        g_warning("Failed to allocate snapshot");
+        fee_snapshot_unref(previous);
+        app_data.is_updating = FALSE;
+        return NULL;
+    }
+    fee_snapshot_set_source(snapshot, "mempool.space");
+    gint64 started = g_get_monotonic_time();
+    
+    // Fetch data from APIs; transient allocations come from the cycle arena
+    arena_bind(&app_data.fetch_arena);
+    gboolean have_fees = fetch_fee_data(snapshot);
+    fetch_btc_price(snapshot);
+    fetch_mempool_data(snapshot);
+    arena_bind(NULL);
+    
+    snapshot->latency_ms = (g_get_monotonic_time() - started) / 1000.0;
+    fee_snapshot_seal(snapshot, previous);
+    publish_snapshot(snapshot, have_fees);
+    fee_snapshot_unref(snapshot);
+    fee_snapshot_unref(previous);
+    
+    // Results were copied into the snapshot, so the cycle's memory can be recycled
+    ArenaStats stats;
+    arena_get_stats(&app_data.fetch_arena, &stats);
+    g_debug("Refresh cycle: %zu bytes in arena, %lu arena mallocs, %lu hook fallbacks",
+            stats.bytes_used, stats.chunk_allocs, arena_hook_fallback_count());
+    arena_reset(&app_data.fetch_arena);
+    
+    // Write a batch that has waited too long even if no new rows arrived;
+    // the store is only touched from this thread while the app runs
+    fee_store_flush_due(&app_data.store, time(NULL));
     
     app_data.is_updating = FALSE;
     return NULL;
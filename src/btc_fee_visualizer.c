@@ -1,6 +1,9 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <ncurses.h>
+#include <locale.h>
 #include <curl/curl.h>
 #include <cjson/cJSON.h>
 #include <time.h>
@@ -9,47 +12,81 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include "fee_stats.h"
+#include "arena.h"
+#include "braille_graph.h"
+#include "fee_history.h"
+#include "fee_snapshot.h"
+#include "fee_store.h"
+#include "spsc_queue.h"
 
-#define MAX_HISTORY 72  // Guardar hasta 72 puntos (6 horas con actualizaciones cada 5 minutos)
 #define CACHE_FILE "/tmp/btc_fee_cache.json"
+#define CACHE_SOURCE "caché"  // Fuente de las instantáneas servidas desde la caché
 #define MAX_SOURCES 3
+#define STATS_WINDOW 60       // Muestras en la ventana de estadísticas (las últimas 60)
+#define STATS_EWMA_ALPHA 0.2  // Suavizado de la media móvil exponencial
+#define CLI_FEE_TIERS 3       // Niveles mostrados en la CLI: rápido, medio y lento
+#define FETCH_ARENA_CHUNK (64 * 1024)          // Bloque de la arena del ciclo de refresco
+#define RESPONSE_INITIAL_CAPACITY (16 * 1024)  // Capacidad inicial de cada respuesta
+#define FETCH_QUEUE_CAPACITY 16                // Peticiones y resultados en vuelo
+#define DEFAULT_UPDATE_INTERVAL 30  // segundos entre actualizaciones
+#define RETRY_INTERVAL 5            // segundos hasta reintentar tras un fallo
+#define DAEMON_MAX_CLIENTS 8        // Clientes simultáneos del socket (modo sin pantalla)
+#define JSONL_LINE_MAX 1024         // Longitud máxima de una línea JSON
+#define HISTORY_SECONDS (24 * 60 * 60)                         // Día mostrado en la tendencia
 
-// Estructura para un punto en el historial
+// Estado de la CLI: la última instantánea publicada y lo derivado de ella
 typedef struct {
-    double fastest;
-    double halfHour;
-    double hour;
-    time_t timestamp;
-} FeeHistoryPoint;
+    FeeSnapshot *snapshot;      // Última instantánea publicada (con referencia)
+    
+    // Historial
+    FeeHistory history;         // Historial de tarifas (anillo en archivo)
+    FeeStats stats;             // Estadísticas móviles por nivel
+    
+    // Versiones ya consumidas (las instantáneas sin cambios se omiten)
+    uint64_t recorded_version;  // Registrada en historial y estadísticas
+    uint64_t exported_version;  // Escrita en el CSV
+    
+    // Estado de las descargas en segundo plano
+    int fetch_pending;          // Peticiones enviadas sin resultado
+    int fetch_failed;           // La última descarga falló
+    double fetch_latency_ms;    // Duración de la última descarga
+    char fetch_source[32];      // Fuente de la última descarga
+    uint64_t fetch_revision;    // Crece con cada cambio de estado
+} FeeData;
 
-// Estructura para el historial de tarifas
+// Resumen de las muestras de un nivel en una columna de puntos braille
 typedef struct {
-    FeeHistoryPoint *points;
-    int size;
-    int capacity;
-    int current;
-} FeeHistory;
+    double first, last;
+    double low, high;
+} TrendColumn;
 
-// Estructura para almacenar datos de tarifas
+// Columnas del gráfico de tendencia, alineadas a intervalos fijos de tiempo.
+// Una muestra nueva solo cambia la última columna; al empezar un intervalo
+// nuevo el gráfico se desplaza una celda entera (dos columnas).
 typedef struct {
-    // Tarifas actuales
-    double fastestFee;      // Fastest fee (sat/vB)
-    double halfHourFee;     // Half hour fee (sat/vB)
-    double hourFee;         // Hour fee (sat/vB)
-    
-    // Datos de la red
-    int blocks;             // Current block height
-    double mempoolSizeMB;   // Mempool size in MB
-    
-    // Precios
-    double btc_price_usd;   // Precio de BTC en USD
-    double btc_price_eur;   // Precio de BTC en EUR
-    
-    // Historial
-    FeeHistory history;     // Historial de tarifas
-    
-    time_t timestamp;       // Last update time
-} FeeData;
+    TrendColumn *columns;       // count * CLI_FEE_TIERS
+    int *samples;               // Muestras en cada columna
+    int count;                  // Columnas de puntos (dos por celda)
+    int64_t bucket_seconds;     // Segundos que cubre cada columna
+    int64_t first_bucket;       // Intervalo de la columna 0 (siempre par)
+    int64_t last_timestamp;     // Última muestra incluida
+    double max_fee;             // Escala del último trazado
+    int dirty_from;             // Primera columna por volver a trazar
+    int valid;
+} TrendColumns;
 
 // Variable global para controlar la visualización del historial
 int show_history = 1;
@@ -60,6 +97,7 @@ typedef struct {
     const char *fee_url;
     const char *mempool_url;
     const char *price_url;
+    const char *mempool_blocks_url;  // Bloques proyectados (opcional)
 } DataSource;
 
 // Fuentes de datos disponibles
@@ -68,116 +106,144 @@ const DataSource data_sources[MAX_SOURCES] = {
         "mempool.space",
         "https://mempool.space/api/v1/fees/recommended",
         "https://mempool.space/api/mempool",
-        "https://api.coingecko.com/api/v3/simple/price?ids=bitcoin&vs_currencies=usd,eur"
+        "https://api.coingecko.com/api/v3/simple/price?ids=bitcoin&vs_currencies=usd,eur",
+        "https://mempool.space/api/v1/fees/mempool-blocks"
     },
     {
         "blockstream.info",
         "https://blockstream.info/api/fee-estimates",
         "https://blockstream.info/api/mempool",
-        "https://blockchain.info/ticker"
+        "https://blockchain.info/ticker",
+        NULL
     },
     {
         "bitcoinfees.earn.com",
         "https://bitcoinfees.earn.com/api/v1/fees/recommended",
         "https://bitcoinfees.earn.com/api/v1/fees/list",
-        "https://api.coincap.io/v2/rates/bitcoin"
+        "https://api.coincap.io/v2/rates/bitcoin",
+        NULL
     }
 };
 
-int current_source = 0;  // Fuente de datos actual
+int current_source = 0;  // Fuente de datos actual (solo el hilo de descarga)
+
+// Memoria transitoria de cada ciclo de refresco y manejador CURL reutilizado.
+// Solo los usa el hilo de descarga.
+static Arena fetch_arena;
+static CURL *http_handle = NULL;
+
+// Se activa al salir para cortar las transferencias en curso
+static atomic_int fetch_cancel = 0;
 
 // Estructura para el caché
 typedef struct {
-    FeeData data;
+    FeeMetrics metrics;
     time_t timestamp;
 } CacheEntry;
 
 // Declaraciones de funciones
-void init_fee_history(FeeHistory *history, int capacity);
-void add_to_history(FeeHistory *history, double fastest, double halfHour, double hour);
-void draw_trend_graph(WINDOW *win, FeeHistory *history, int y, int x, int height, int width);
+void record_fee_sample(FeeData *fee_data);
+void draw_trend_graph(WINDOW *win, BrailleCanvas *canvas, TrendColumns *trend, int y, int x);
 void draw_fee_visualization(FeeData *fee_data);
 
 // Callback function for CURL to write response
 size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
-    char **response_ptr = (char **)userp;
+    ArenaBuffer *response = (ArenaBuffer *)userp;
     
-    *response_ptr = realloc(*response_ptr, realsize + 1);
-    if (*response_ptr == NULL) {
+    if (!arena_buffer_append(response, contents, realsize)) {
         return 0;
     }
     
-    memcpy(*response_ptr, contents, realsize);
-    (*response_ptr)[realsize] = '\0';
-    
     return realsize;
 }
 
+// Corta la transferencia en curso cuando la CLI está saliendo
+static int transfer_progress(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                             curl_off_t ultotal, curl_off_t ulnow) {
+    (void)clientp; (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow;
+    return atomic_load(&fetch_cancel);
+}
+
+// Petición GET sobre un buffer de la arena reutilizando el manejador CURL
+int http_get(const char *url, ArenaBuffer *response) {
+    if (!http_handle) {
+        http_handle = curl_easy_init();
+        if (!http_handle) {
+            fprintf(stderr, "Error al inicializar CURL\n");
+            return 0;
+        }
+    }
+    
+    arena_buffer_init(response, &fetch_arena, RESPONSE_INITIAL_CAPACITY);
+    if (!response->data) return 0;
+    
+    curl_easy_setopt(http_handle, CURLOPT_URL, url);
+    curl_easy_setopt(http_handle, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(http_handle, CURLOPT_WRITEDATA, response);
+    curl_easy_setopt(http_handle, CURLOPT_TIMEOUT, 5L);
+    curl_easy_setopt(http_handle, CURLOPT_NOSIGNAL, 1L);  // Fuera del hilo principal
+    curl_easy_setopt(http_handle, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(http_handle, CURLOPT_XFERINFOFUNCTION, transfer_progress);
+    
+    return curl_easy_perform(http_handle) == CURLE_OK;
+}
+
 // Obtener el precio de Bitcoin desde CoinGecko
-int fetch_btc_price(FeeData *fee_data) {
-    CURL *curl = curl_easy_init();
-    char *response = NULL;
+int fetch_btc_price(FeeSnapshot *snapshot) {
+    ArenaBuffer response;
     int success = 0;
     
-    if (curl) {
-        // Usamos la API de CoinGecko para obtener precios
-        curl_easy_setopt(curl, CURLOPT_URL, "https://api.coingecko.com/api/v3/simple/price?ids=bitcoin&vs_currencies=usd,eur");
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
-        
-        if (curl_easy_perform(curl) == CURLE_OK && response) {
-            cJSON *json = cJSON_Parse(response);
-            if (json) {
-                cJSON *bitcoin = cJSON_GetObjectItemCaseSensitive(json, "bitcoin");
-                if (bitcoin) {
-                    cJSON *usd = cJSON_GetObjectItemCaseSensitive(bitcoin, "usd");
-                    cJSON *eur = cJSON_GetObjectItemCaseSensitive(bitcoin, "eur");
-                    
-                    if (cJSON_IsNumber(usd) && cJSON_IsNumber(eur)) {
-                        fee_data->btc_price_usd = usd->valuedouble;
-                        fee_data->btc_price_eur = eur->valuedouble;
-                        success = 1;
-                    }
+    // Usamos la API de CoinGecko para obtener precios
+    if (http_get("https://api.coingecko.com/api/v3/simple/price?ids=bitcoin&vs_currencies=usd,eur", &response)) {
+        cJSON *json = cJSON_Parse(response.data);
+        if (json) {
+            cJSON *bitcoin = cJSON_GetObjectItemCaseSensitive(json, "bitcoin");
+            if (bitcoin) {
+                cJSON *usd = cJSON_GetObjectItemCaseSensitive(bitcoin, "usd");
+                cJSON *eur = cJSON_GetObjectItemCaseSensitive(bitcoin, "eur");
+                
+                if (cJSON_IsNumber(usd) && cJSON_IsNumber(eur)) {
+                    snapshot->metrics.btc_price_usd = usd->valuedouble;
+                    snapshot->metrics.btc_price_eur = eur->valuedouble;
+                    success = 1;
                 }
-                cJSON_Delete(json);
             }
+            cJSON_Delete(json);
         }
-        
-        if (response) free(response);
-        curl_easy_cleanup(curl);
     }
     
     return success;
 }
 
 // Función para guardar en caché
-int save_to_cache(const FeeData *data) {
+int save_to_cache(const FeeSnapshot *snapshot) {
     FILE *f = fopen(CACHE_FILE, "w");
     if (!f) return 0;
     
+    const FeeMetrics *m = &snapshot->metrics;
     cJSON *root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "fastestFee", data->fastestFee);
-    cJSON_AddNumberToObject(root, "halfHourFee", data->halfHourFee);
-    cJSON_AddNumberToObject(root, "hourFee", data->hourFee);
-    cJSON_AddNumberToObject(root, "blocks", data->blocks);
-    cJSON_AddNumberToObject(root, "mempoolSizeMB", data->mempoolSizeMB);
-    cJSON_AddNumberToObject(root, "btc_price_usd", data->btc_price_usd);
-    cJSON_AddNumberToObject(root, "btc_price_eur", data->btc_price_eur);
-    cJSON_AddNumberToObject(root, "timestamp", (double)time(NULL));
+    cJSON_AddNumberToObject(root, "fastestFee", m->fastest_fee);
+    cJSON_AddNumberToObject(root, "halfHourFee", m->half_hour_fee);
+    cJSON_AddNumberToObject(root, "hourFee", m->hour_fee);
+    cJSON_AddNumberToObject(root, "blocks", (double)m->mempool_tx_count);
+    // En bytes enteros: pasar por MB no vuelve al mismo valor y cambiaría la versión
+    cJSON_AddNumberToObject(root, "mempoolVSize", (double)m->mempool_vsize);
+    cJSON_AddNumberToObject(root, "btc_price_usd", m->btc_price_usd);
+    cJSON_AddNumberToObject(root, "btc_price_eur", m->btc_price_eur);
+    cJSON_AddNumberToObject(root, "timestamp", (double)snapshot->timestamp);
     
     char *json_str = cJSON_Print(root);
     fputs(json_str, f);
     
-    free(json_str);
+    cJSON_free(json_str);
     cJSON_Delete(root);
     fclose(f);
     return 1;
 }
 
 // Función para cargar desde caché
-int load_from_cache(FeeData *data) {
+int load_from_cache(FeeSnapshot *snapshot) {
     FILE *f = fopen(CACHE_FILE, "r");
     if (!f) return 0;
     
@@ -185,35 +251,40 @@ int load_from_cache(FeeData *data) {
     long fsize = ftell(f);
     fseek(f, 0, SEEK_SET);
     
-    char *json_str = (char *)malloc(fsize + 1);
-    if (fread(json_str, 1, fsize, f) != (size_t)fsize) {
-        free(json_str);
+    char *json_str = (char *)arena_alloc(&fetch_arena, fsize + 1);
+    if (!json_str || fread(json_str, 1, fsize, f) != (size_t)fsize) {
         fclose(f);
         return 0;
     }
     json_str[fsize] = '\0';
+    fclose(f);
     
     cJSON *root = cJSON_Parse(json_str);
-    free(json_str);
     
     if (!root) return 0;
     
+    FeeMetrics *m = &snapshot->metrics;
     cJSON *item;
-    if ((item = cJSON_GetObjectItem(root, "fastestFee"))) data->fastestFee = item->valuedouble;
-    if ((item = cJSON_GetObjectItem(root, "halfHourFee"))) data->halfHourFee = item->valuedouble;
-    if ((item = cJSON_GetObjectItem(root, "hourFee"))) data->hourFee = item->valuedouble;
-    if ((item = cJSON_GetObjectItem(root, "blocks"))) data->blocks = item->valueint;
-    if ((item = cJSON_GetObjectItem(root, "mempoolSizeMB"))) data->mempoolSizeMB = item->valuedouble;
-    if ((item = cJSON_GetObjectItem(root, "btc_price_usd"))) data->btc_price_usd = item->valuedouble;
-    if ((item = cJSON_GetObjectItem(root, "btc_price_eur"))) data->btc_price_eur = item->valuedouble;
-    if ((item = cJSON_GetObjectItem(root, "timestamp"))) data->timestamp = (time_t)item->valuedouble;
+    if ((item = cJSON_GetObjectItem(root, "fastestFee"))) m->fastest_fee = item->valuedouble;
+    if ((item = cJSON_GetObjectItem(root, "halfHourFee"))) m->half_hour_fee = item->valuedouble;
+    if ((item = cJSON_GetObjectItem(root, "hourFee"))) m->hour_fee = item->valuedouble;
+    if ((item = cJSON_GetObjectItem(root, "blocks"))) m->mempool_tx_count = (int64_t)item->valuedouble;
+    if ((item = cJSON_GetObjectItem(root, "mempoolVSize"))) {
+        m->mempool_vsize = (int64_t)item->valuedouble;
+    } else if ((item = cJSON_GetObjectItem(root, "mempoolSizeMB"))) {
+        // Cachés escritas por versiones anteriores
+        m->mempool_vsize = llround(item->valuedouble * 1000000.0);
+    }
+    if ((item = cJSON_GetObjectItem(root, "btc_price_usd"))) m->btc_price_usd = item->valuedouble;
+    if ((item = cJSON_GetObjectItem(root, "btc_price_eur"))) m->btc_price_eur = item->valuedouble;
+    if ((item = cJSON_GetObjectItem(root, "timestamp"))) snapshot->timestamp = (time_t)item->valuedouble;
     
     cJSON_Delete(root);
     return 1;
 }
 
 // Función para exportar datos actuales a CSV
-void export_data_to_csv(const FeeData *data, const char *filename) {
+void export_data_to_csv(const FeeSnapshot *snapshot, const char *filename) {
     FILE *f = fopen(filename, "a");
     if (!f) return;
     
@@ -224,18 +295,19 @@ void export_data_to_csv(const FeeData *data, const char *filename) {
     
     // Obtener la hora local
     char time_str[64];
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&data->timestamp));
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&snapshot->timestamp));
     
     // Escribir los datos
-    fprintf(f, "\"%s\",%.1f,%.1f,%.1f,%d,%.2f,%.2f,%.2f\n",
+    const FeeMetrics *m = &snapshot->metrics;
+    fprintf(f, "\"%s\",%.1f,%.1f,%.1f,%lld,%.2f,%.2f,%.2f\n",
             time_str,
-            data->fastestFee,
-            data->halfHourFee,
-            data->hourFee,
-            data->blocks,
-            data->mempoolSizeMB,
-            data->btc_price_usd,
-            data->btc_price_eur);
+            m->fastest_fee,
+            m->half_hour_fee,
+            m->hour_fee,
+            (long long)m->mempool_tx_count,
+            m->mempool_vsize / 1000000.0,
+            m->btc_price_usd,
+            m->btc_price_eur);
     
     fclose(f);
 }
@@ -247,41 +319,35 @@ void export_history_to_csv(const FeeHistory *history, const char *filename) {
     
     fprintf(f, "timestamp,fastest_fee,half_hour_fee,hour_fee\n");
     
-    for (int i = 0; i < history->size; i++) {
+    size_t size = fee_history_size(history);
+    for (size_t i = 0; i < size; i++) {
+        const FeeHistoryPoint *point = fee_history_point(history, i);
+        time_t timestamp = (time_t)point->timestamp;
         char time_str[64];
-        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&history->points[i].timestamp));
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&timestamp));
         
         fprintf(f, "\"%s\",%.1f,%.1f,%.1f\n",
                 time_str,
-                history->points[i].fastest,
-                history->points[i].halfHour,
-                history->points[i].hour);
+                point->fastest,
+                point->halfHour,
+                point->hour);
     }
     
     fclose(f);
 }
 
 // Función para obtener datos de una fuente específica
-int fetch_from_source(const DataSource *source, FeeData *fee_data) {
-    CURL *curl = curl_easy_init();
-    char *response = NULL;
+int fetch_from_source(const DataSource *source, FeeSnapshot *snapshot) {
+    ArenaBuffer response;
     int success = 0;
+    FeeMetrics *m = &snapshot->metrics;
     
-    if (!curl) {
-        fprintf(stderr, "Error al inicializar CURL\n");
-        return 0;
-    }
-    
-    fee_data->timestamp = time(NULL);
+    snapshot->timestamp = time(NULL);
+    fee_snapshot_set_source(snapshot, source->name);
     
     // Obtener tarifas recomendadas
-    curl_easy_setopt(curl, CURLOPT_URL, source->fee_url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
-    
-    if (curl_easy_perform(curl) == CURLE_OK && response) {
-        cJSON *json = cJSON_Parse(response);
+    if (http_get(source->fee_url, &response)) {
+        cJSON *json = cJSON_Parse(response.data);
         if (json) {
             // Manejar diferentes formatos de respuesta
             cJSON *fastest = cJSON_GetObjectItemCaseSensitive(json, "fastestFee");
@@ -294,102 +360,383 @@ int fetch_from_source(const DataSource *source, FeeData *fee_data) {
             if (!hour) hour = cJSON_GetObjectItemCaseSensitive(json, "144");
             
             if (cJSON_IsNumber(fastest) && cJSON_IsNumber(halfHour) && cJSON_IsNumber(hour)) {
-                fee_data->fastestFee = fastest->valuedouble;
-                fee_data->halfHourFee = halfHour->valuedouble;
-                fee_data->hourFee = hour->valuedouble;
+                m->fastest_fee = fastest->valuedouble;
+                m->half_hour_fee = halfHour->valuedouble;
+                m->hour_fee = hour->valuedouble;
                 success = 1;
             }
             cJSON_Delete(json);
         }
-        free(response);
-        response = NULL;
     }
     
     // Obtener información del mempool
-    if (success && source->mempool_url) {
-        curl_easy_setopt(curl, CURLOPT_URL, source->mempool_url);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-        
-        if (curl_easy_perform(curl) == CURLE_OK && response) {
-            cJSON *json = cJSON_Parse(response);
-            if (json) {
-                // Manejar diferentes formatos de respuesta
-                cJSON *count = cJSON_GetObjectItemCaseSensitive(json, "count");
-                cJSON *vsize = cJSON_GetObjectItemCaseSensitive(json, "vsize");
-                
-                if (!count) count = cJSON_GetObjectItemCaseSensitive(json, "n_tx");
-                if (!vsize) vsize = cJSON_GetObjectItemCaseSensitive(json, "vsize");
-                
-                if (cJSON_IsNumber(count)) {
-                    fee_data->blocks = count->valueint;
-                }
-                if (cJSON_IsNumber(vsize)) {
-                    fee_data->mempoolSizeMB = vsize->valueint / 1000000.0; // Convertir a MB
-                }
-                cJSON_Delete(json);
+    MempoolDepth *depth = NULL;
+    if (success && source->mempool_url && http_get(source->mempool_url, &response)) {
+        cJSON *json = cJSON_Parse(response.data);
+        if (json) {
+            // Manejar diferentes formatos de respuesta
+            cJSON *count = cJSON_GetObjectItemCaseSensitive(json, "count");
+            cJSON *vsize = cJSON_GetObjectItemCaseSensitive(json, "vsize");
+            
+            if (!count) count = cJSON_GetObjectItemCaseSensitive(json, "n_tx");
+            if (!vsize) vsize = cJSON_GetObjectItemCaseSensitive(json, "vsize");
+            
+            if (cJSON_IsNumber(count)) {
+                m->mempool_tx_count = (int64_t)count->valuedouble;
             }
-            free(response);
-            response = NULL;
+            if (cJSON_IsNumber(vsize)) {
+                m->mempool_vsize = (int64_t)vsize->valuedouble;
+            }
+            
+            // Histograma de tarifas de la misma respuesta
+            depth = mempool_depth_new();
+            if (depth && mempool_depth_load_histogram(depth,
+                    cJSON_GetObjectItemCaseSensitive(json, "fee_histogram")) == 0) {
+                mempool_depth_unref(depth);
+                depth = NULL;
+            }
+            cJSON_Delete(json);
         }
     }
     
-    // Obtener precio de Bitcoin
-    if (success && source->price_url) {
-        fetch_btc_price(fee_data); // La función ya maneja su propia lógica de fuentes
+    // Bloques proyectados, si la fuente los ofrece
+    if (success && source->mempool_blocks_url && http_get(source->mempool_blocks_url, &response)) {
+        cJSON *json = cJSON_Parse(response.data);
+        if (json) {
+            if (!depth) depth = mempool_depth_new();
+            if (depth && mempool_depth_load_blocks(depth, json) == 0 && depth->bucket_count == 0) {
+                mempool_depth_unref(depth);
+                depth = NULL;
+            }
+            cJSON_Delete(json);
+        }
+    }
+    
+    // Sin datos nuevos se conserva la profundidad anterior
+    if (depth) {
+        fee_snapshot_set_depth(snapshot, depth);
     }
     
-    // Si todo salió bien, guardar en caché
-    if (success) {
-        save_to_cache(fee_data);
+    // Obtener precio de Bitcoin
+    if (success && source->price_url) {
+        fetch_btc_price(snapshot); // La función ya maneja su propia lógica de fuentes
     }
     
-    curl_easy_cleanup(curl);
     return success;
 }
 
-// Función para obtener datos, con reintentos y caché
-int fetch_fee_data(FeeData *fee_data) {
+// Milisegundos de un reloj monótono
+static double monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Función para obtener datos, con reintentos y caché. Construye una instantánea
+// nueva a partir de la anterior y la devuelve sellada y con una referencia, o
+// NULL si ninguna fuente respondió. Sin `use_cache` siempre se consulta la red,
+// como necesita el modo sin pantalla para respetar su intervalo. Solo se llama
+// desde el hilo de descarga.
+FeeSnapshot *fetch_fee_data(const FeeSnapshot *previous, int use_cache) {
     int attempts = 0;
     int success = 0;
     
+    FeeSnapshot *snapshot = fee_snapshot_new(previous);
+    if (!snapshot) return NULL;
+    double started = monotonic_ms();
+    
+    // Las reservas transitorias del ciclo (respuestas, árboles cJSON) salen de la arena
+    arena_bind(&fetch_arena);
+    
     // Primero intentar cargar desde caché
-    if (load_from_cache(fee_data)) {
+    if (use_cache && load_from_cache(snapshot)) {
         time_t now = time(NULL);
         // Si los datos en caché tienen menos de 5 minutos, usarlos
-        if (difftime(now, fee_data->timestamp) < 300) {
-            return 1;
+        if (difftime(now, snapshot->timestamp) < 300) {
+            fee_snapshot_set_source(snapshot, CACHE_SOURCE);
+            success = 1;
+        } else {
+            // Caché caducada: se descartan sus valores
+            FeeSnapshot *fresh = fee_snapshot_new(previous);
+            if (fresh) {
+                fee_snapshot_unref(snapshot);
+                snapshot = fresh;
+            }
         }
     }
     
     // Intentar con cada fuente hasta que una funcione
-    while (attempts < MAX_SOURCES && !success) {
+    while (attempts < MAX_SOURCES && !success && !atomic_load(&fetch_cancel)) {
         current_source = (current_source + 1) % MAX_SOURCES;
-        success = fetch_from_source(&data_sources[current_source], fee_data);
+        success = fetch_from_source(&data_sources[current_source], snapshot);
         attempts++;
+        
+        // Una lectura de la red se comparte con otros procesos por la caché;
+        // el modo sin pantalla no la toca para no depender de ellos ni alterarlos
+        if (success && use_cache) {
+            save_to_cache(snapshot);
+        }
     }
     
-    return success;
+    // Los datos ya están copiados en la instantánea: se recicla la memoria del ciclo
+    arena_bind(NULL);
+    arena_reset(&fetch_arena);
+    
+    // Sellar la instantánea; si las métricas no cambian conserva la versión
+    if (!success) {
+        fee_snapshot_unref(snapshot);
+        return NULL;
+    }
+    snapshot->latency_ms = monotonic_ms() - started;
+    fee_snapshot_seal(snapshot, previous);
+    return snapshot;
+}
+
+// Peticiones al hilo de descarga
+typedef enum {
+    FETCH_SCHEDULED,    // Actualización programada
+    FETCH_MANUAL,       // Actualización pedida con 'r'
+    FETCH_NEXT_SOURCE,  // Pasar a la siguiente fuente ('s')
+    FETCH_QUIT
+} FetchCommand;
+
+// Resultado de una petición, publicado al bucle principal
+typedef struct {
+    FetchCommand command;
+    FeeSnapshot *snapshot;  // Instantánea nueva con una referencia, o NULL si falló
+    double latency_ms;      // Duración total, incluidos los reintentos
+    char source[32];        // Fuente que respondió (o la última probada)
+} FetchResult;
+
+// Hilo de descarga. Las peticiones y los resultados viajan por colas sin
+// bloqueos; cada cola tiene un eventfd que despierta a su consumidor.
+typedef struct {
+    pthread_t thread;
+    SpscQueue requests;     // Bucle principal → hilo
+    SpscQueue results;      // Hilo → bucle principal
+    int request_fd;         // Bloqueante: el hilo duerme en read()
+    int result_fd;          // No bloqueante: lo vigila poll()
+    FeeSnapshot *last;      // Última instantánea obtenida (solo el hilo)
+    int use_cache;          // Servir lecturas recientes desde la caché compartida
+} Fetcher;
+
+static Fetcher fetcher;
+
+// Avisa a través de un eventfd
+static void eventfd_signal(int fd) {
+    uint64_t one = 1;
+    ssize_t written = write(fd, &one, sizeof(one));
+    (void)written;  // Solo falla si el contador desborda, y entonces ya hay aviso pendiente
+}
+
+// Bucle del hilo de descarga: atiende las peticiones en orden y publica
+// cada resultado
+static void *fetch_thread(void *data) {
+    Fetcher *f = (Fetcher *)data;
+    
+    while (1) {
+        uint64_t pending;
+        if (read(f->request_fd, &pending, sizeof(pending)) < 0 && errno != EINTR) break;
+        
+        FetchCommand command;
+        while (spsc_queue_pop(&f->requests, &command)) {
+            if (command == FETCH_QUIT) goto done;
+            if (command == FETCH_NEXT_SOURCE) {
+                current_source = (current_source + 1) % MAX_SOURCES;
+            }
+            
+            FetchResult result = { .command = command };
+            double started = monotonic_ms();
+            result.snapshot = fetch_fee_data(f->last, f->use_cache);
+            result.latency_ms = monotonic_ms() - started;
+            
+            if (result.snapshot) {
+                fee_snapshot_unref(f->last);
+                f->last = fee_snapshot_ref(result.snapshot);
+                memcpy(result.source, result.snapshot->source, sizeof(result.source));
+            } else {
+                snprintf(result.source, sizeof(result.source), "%s", data_sources[current_source].name);
+            }
+            
+            if (!spsc_queue_push(&f->results, &result)) {
+                fee_snapshot_unref(result.snapshot);
+                continue;
+            }
+            eventfd_signal(f->result_fd);
+        }
+    }
+    
+done:
+    if (http_handle) {
+        curl_easy_cleanup(http_handle);
+        http_handle = NULL;
+    }
+    return NULL;
 }
 
-// Cambiar a la siguiente fuente de datos
-void cycle_data_source() {
-    current_source = (current_source + 1) % MAX_SOURCES;
-    // Forzar actualización con la nueva fuente
-    FeeData fd;
-    if (fetch_fee_data(&fd)) {
-        // Actualizar la visualización
-        draw_fee_visualization(&fd);
+// Crea las colas, los eventfd y el hilo de descarga
+static int fetcher_start(Fetcher *f, int use_cache) {
+    f->use_cache = use_cache;
+    if (!spsc_queue_init(&f->requests, sizeof(FetchCommand), FETCH_QUEUE_CAPACITY) ||
+        !spsc_queue_init(&f->results, sizeof(FetchResult), FETCH_QUEUE_CAPACITY)) {
+        return 0;
     }
+    
+    f->request_fd = eventfd(0, EFD_CLOEXEC);
+    f->result_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (f->request_fd < 0 || f->result_fd < 0) return 0;
+    
+    return pthread_create(&f->thread, NULL, fetch_thread, f) == 0;
+}
+
+// Envía una petición al hilo de descarga
+static int fetcher_request(Fetcher *f, FetchCommand command) {
+    if (!spsc_queue_push(&f->requests, &command)) return 0;
+    eventfd_signal(f->request_fd);
+    return 1;
+}
+
+// Detiene el hilo cortando la descarga en curso y libera lo pendiente
+static void fetcher_stop(Fetcher *f) {
+    atomic_store(&fetch_cancel, 1);
+    fetcher_request(f, FETCH_QUIT);
+    pthread_join(f->thread, NULL);
+    
+    FetchResult result;
+    while (spsc_queue_pop(&f->results, &result)) {
+        fee_snapshot_unref(result.snapshot);
+    }
+    fee_snapshot_unref(f->last);
+    f->last = NULL;
+    
+    close(f->request_fd);
+    close(f->result_fd);
+    spsc_queue_free(&f->requests);
+    spsc_queue_free(&f->results);
+}
+
+// Paneles persistentes de la pantalla, de arriba abajo
+enum {
+    PANEL_HEADER,   // Título, estado de la descarga y mempool
+    PANEL_BARS,     // Barras de tarifas y escala
+    PANEL_PRICES,   // Precio y costo estimado
+    PANEL_TREND,    // Gráfico de tendencia
+    PANEL_FOOTER,   // Ayuda, contador y controles (siempre al final)
+    PANEL_COUNT
+};
+
+// Filas de cada panel
+#define HEADER_ROWS 7
+#define BARS_ROWS 9
+#define PRICES_ROWS 2
+#define TREND_ROWS 11
+#define FOOTER_ROWS 4
+#define FOOTER_MESSAGE_SECONDS 2  // Duración de los avisos del pie
+
+// Pantalla de la CLI: cada panel es una ventana persistente que solo se
+// redibuja cuando cambian los datos que muestra. Los paneles modificados se
+// copian con wnoutrefresh() y el terminal se actualiza una vez con doupdate(),
+// de modo que ncurses solo envía las celdas que cambian.
+typedef struct {
+    WINDOW *panels[PANEL_COUNT];  // NULL si el panel no cabe en el terminal
+    unsigned dirty;               // Paneles pendientes (un bit por panel)
+    
+    // Datos con los que se dibujó cada panel por última vez
+    uint64_t header_sequence;
+    uint64_t header_fetch_revision;
+    uint64_t bars_version;
+    uint64_t bars_recorded;
+    uint64_t prices_version;
+    uint64_t trend_recorded;
+    int trend_visible;
+    BrailleCanvas trend_canvas;   // Celdas braille del gráfico de tendencia
+    TrendColumns trend_columns;   // Resumen por columna del último día
+    time_t next_update;           // Hora de la próxima actualización programada
+    
+    // Aviso temporal del pie
+    char message[128];
+    time_t message_until;
+} CliScreen;
+
+static CliScreen screen;
+
+// Crea las ventanas de los paneles según el tamaño actual del terminal.
+// Se llama al iniciar y tras cada cambio de tamaño.
+static void screen_layout(void) {
+    static const int panel_rows[PANEL_FOOTER] = { HEADER_ROWS, BARS_ROWS, PRICES_ROWS, TREND_ROWS };
+    
+    for (int i = 0; i < PANEL_COUNT; i++) {
+        if (screen.panels[i]) delwin(screen.panels[i]);
+        screen.panels[i] = NULL;
+    }
+    
+    int max_y, max_x;
+    getmaxyx(stdscr, max_y, max_x);
+    int footer_top = max_y > FOOTER_ROWS ? max_y - FOOTER_ROWS : 0;
+    
+    // Los paneles que no caben se recortan o se omiten; el pie siempre se muestra
+    int top = 0;
+    for (int i = 0; i < PANEL_FOOTER; i++) {
+        int height = panel_rows[i];
+        if (top + height > footer_top) height = footer_top - top;
+        if (height > 0) screen.panels[i] = newwin(height, max_x, top, 0);
+        top += panel_rows[i];
+    }
+    if (max_y > footer_top) {
+        screen.panels[PANEL_FOOTER] = newwin(max_y - footer_top, max_x, footer_top, 0);
+    }
+    
+    // stdscr queda como fondo vacío y no vuelve a tocarse
+    erase();
+    wnoutrefresh(stdscr);
+    braille_canvas_invalidate(&screen.trend_canvas);
+    screen.dirty = (1u << PANEL_COUNT) - 1;
+}
+
+// Libera las ventanas de los paneles
+static void screen_free(void) {
+    for (int i = 0; i < PANEL_COUNT; i++) {
+        if (screen.panels[i]) delwin(screen.panels[i]);
+        screen.panels[i] = NULL;
+    }
+    braille_canvas_free(&screen.trend_canvas);
+    free(screen.trend_columns.columns);
+    free(screen.trend_columns.samples);
+    memset(&screen.trend_columns, 0, sizeof(screen.trend_columns));
+}
+
+// Muestra la hora de la próxima actualización. Se indica la hora y no una
+// cuenta atrás para no tener que despertar cada segundo.
+static void screen_set_next_update(time_t next_update) {
+    if (next_update == screen.next_update) return;
+    screen.next_update = next_update;
+    screen.dirty |= 1u << PANEL_FOOTER;
+}
+
+// Muestra un aviso en el pie durante unos segundos
+static void screen_show_message(const char *message) {
+    snprintf(screen.message, sizeof(screen.message), "%s", message);
+    screen.message_until = time(NULL) + FOOTER_MESSAGE_SECONDS;
+    screen.dirty |= 1u << PANEL_FOOTER;
+}
+
+// Milisegundos hasta que caduca el aviso del pie, o -1 si no hay ninguno
+static int screen_message_timeout_ms(void) {
+    if (!screen.message[0]) return -1;
+    time_t remaining = screen.message_until - time(NULL);
+    return remaining > 0 ? (int)remaining * 1000 : 0;
 }
 
 // Initialize ncurses
 void init_screen() {
+    // Los caracteres braille y los acentos necesitan la codificación del terminal
+    setlocale(LC_CTYPE, "");
     initscr();
     start_color();
     cbreak();
     noecho();
     keypad(stdscr, TRUE);
+    nodelay(stdscr, TRUE);
     curs_set(0);
     
     // Initialize color pairs
@@ -397,323 +744,1058 @@ void init_screen() {
     init_pair(2, COLOR_YELLOW, COLOR_BLACK);
     init_pair(3, COLOR_RED, COLOR_BLACK);
     init_pair(4, COLOR_CYAN, COLOR_BLACK);
+    
+    screen_layout();
 }
 
-// Draw the fee visualization
-void draw_fee_visualization(FeeData *fee_data) {
-    clear();
+// Draw the header panel: title, fetch status and mempool summary. Before the
+// first snapshot arrives only the title and the fetch status are shown.
+static void draw_header_panel(WINDOW *win, const FeeData *fee_data) {
+    const FeeSnapshot *snapshot = fee_data->snapshot;
+    int max_x = getmaxx(win);
     
-    int max_y, max_x;
-    getmaxyx(stdscr, max_y, max_x);
+    werase(win);
     
     // Draw header
-    attron(A_BOLD | COLOR_PAIR(4));
-    mvprintw(1, (max_x - 30) / 2, "BITCOIN TRANSACTION FEES");
+    wattrset(win, A_BOLD | COLOR_PAIR(4));
+    mvwprintw(win, 1, (max_x - 30) / 2, "BITCOIN TRANSACTION FEES");
     
     // Draw additional info
-    mvprintw(2, 2, "Fuente: mempool.space | Tiempo real");
-    attroff(A_BOLD | COLOR_PAIR(4));
+    if (snapshot) {
+        mvwprintw(win, 2, 2, "Fuente: %s | %.0f ms | #%llu", snapshot->source, snapshot->latency_ms,
+                (unsigned long long)snapshot->sequence);
+    }
+    
+    // Estado del hilo de descarga
+    const char *state = fee_data->fetch_pending > 0 ? "actualizando..." :
+                        fee_data->fetch_failed ? "sin respuesta" : "al día";
+    wattrset(win, fee_data->fetch_failed ? COLOR_PAIR(3) | A_BOLD : A_NORMAL);
+    mvwprintw(win, 3, 2, "Estado: %s", state);
+    if (fee_data->fetch_source[0]) {
+        wprintw(win, " | Última descarga: %s, %.0f ms", fee_data->fetch_source, fee_data->fetch_latency_ms);
+    }
+    wattrset(win, A_NORMAL);
+    if (!snapshot) return;
+    
+    const FeeMetrics *m = &snapshot->metrics;
     
     // Draw last update time and mempool info
     char time_str[64];
-    strftime(time_str, sizeof(time_str), "Actualizado: %H:%M:%S", localtime(&fee_data->timestamp));
-    mvprintw(4, 2, "%s", time_str);
+    strftime(time_str, sizeof(time_str), "Actualizado: %H:%M:%S", localtime(&snapshot->timestamp));
+    mvwprintw(win, 4, 2, "%s", time_str);
     
     // Display mempool info if available
-    if (fee_data->blocks > 0) {
-        mvprintw(4, max_x - 20, "Bloque: %d", fee_data->blocks);
+    if (m->mempool_tx_count > 0) {
+        mvwprintw(win, 4, max_x - 20, "Bloque: %lld", (long long)m->mempool_tx_count);
     }
-    if (fee_data->mempoolSizeMB > 0) {
-        mvprintw(5, 2, "Mempool: %.2f MB", fee_data->mempoolSizeMB);
+    if (m->mempool_vsize > 0) {
+        mvwprintw(win, 5, 2, "Mempool: %.2f MB", m->mempool_vsize / 1000000.0);
     }
     
-    // Draw separator
-    mvhline(6, 0, '-', max_x);
+    // Tarifa por objetivo de confirmación calculada con la profundidad local
+    if (snapshot->depth) {
+        mvwprintw(win, 5, 24, "Objetivo 1/3/6 bloques: %.1f / %.1f / %.1f sat/vB",
+                mempool_depth_fee_for_target(snapshot->depth, 1),
+                mempool_depth_fee_for_target(snapshot->depth, 3),
+                mempool_depth_fee_for_target(snapshot->depth, 6));
+    }
     
-    // Calculate bar lengths (max width - 30 for text)
-    int max_bar_width = max_x - 35;
+    // Draw separator
+    mvwhline(win, 6, 0, '-', max_x);
+}
+
+// Draw one fee bar as a single horizontal run
+static void draw_fee_bar(WINDOW *win, int y, const char *label, double fee, double max_fee,
+                         int max_bar_width, int color_pair) {
+    int width = (fee / max_fee) * max_bar_width;
+    width = width < 1 ? 1 : width;  // Ensure minimum width for visibility
+    
+    wattrset(win, COLOR_PAIR(color_pair) | A_BOLD);
+    mvwprintw(win, y, 2, "%s", label);
+    mvwhline(win, y, 25, ' ' | A_REVERSE | COLOR_PAIR(color_pair), width);
+    mvwprintw(win, y, 25 + max_bar_width + 2, "%.1f sat/vB", fee);
+}
+
+// Draw the fee bars, their scale and the rolling window stats
+static void draw_bars_panel(WINDOW *win, const FeeData *fee_data) {
+    const FeeMetrics *m = &fee_data->snapshot->metrics;
     
-    // Find max fee for scaling
-    double max_fee = fee_data->fastestFee;
-    if (fee_data->halfHourFee > max_fee) max_fee = fee_data->halfHourFee;
-    if (fee_data->hourFee > max_fee) max_fee = fee_data->hourFee;
-    max_fee = max_fee * 1.2; // Add 20% padding
+    werase(win);
     
-    // Calculate bar widths
-    int fastest_width = (fee_data->fastestFee / max_fee) * max_bar_width;
-    int half_hour_width = (fee_data->halfHourFee / max_fee) * max_bar_width;
-    int hour_width = (fee_data->hourFee / max_fee) * max_bar_width;
+    // Calculate bar lengths (max width - 35 for text)
+    int max_bar_width = getmaxx(win) - 35;
     
-    // Ensure minimum width for visibility
-    fastest_width = fastest_width < 1 ? 1 : fastest_width;
-    half_hour_width = half_hour_width < 1 ? 1 : half_hour_width;
-    hour_width = hour_width < 1 ? 1 : hour_width;
+    // Find max fee for scaling (rolling window max, so the scale stays stable)
+    double max_fee = fee_stats_max(&fee_data->stats, CLI_FEE_TIERS);
+    if (m->fastest_fee > max_fee) max_fee = m->fastest_fee;
+    if (m->half_hour_fee > max_fee) max_fee = m->half_hour_fee;
+    if (m->hour_fee > max_fee) max_fee = m->hour_fee;
+    if (max_fee <= 0) max_fee = 1;  // Avoid division by zero
+    max_fee = max_fee * 1.2; // Add 20% padding
     
     // Draw bars
-    int y = 8;
+    int y = 1;
+    draw_fee_bar(win, y, "RÁPIDO (10 min):", m->fastest_fee, max_fee, max_bar_width, 3);
+    draw_fee_bar(win, y + 2, "MEDIO (30 min):", m->half_hour_fee, max_fee, max_bar_width, 2);
+    draw_fee_bar(win, y + 4, "LENTO (60 min):", m->hour_fee, max_fee, max_bar_width, 1);
+    
+    // Draw scale
+    wattrset(win, COLOR_PAIR(4) | A_DIM);
+    mvwprintw(win, y + 6, 25, "0");
+    mvwprintw(win, y + 6, 25 + (max_bar_width / 2), "%.0f", max_fee / 2);
+    mvwprintw(win, y + 6, 25 + max_bar_width - 3, "%.0f", max_fee);
+    
+    // Estadísticas de la ventana para la tarifa rápida
+    const RollingStats *fastest_stats = &fee_data->stats.tiers[FEE_TIER_FASTEST];
+    if (rolling_stats_count(fastest_stats) > 1) {
+        mvwprintw(win, y + 7, 25, "Ventana: media %.1f | mín %.1f | máx %.1f | p90 %.1f sat/vB",
+                rolling_stats_mean(fastest_stats),
+                rolling_stats_min(fastest_stats),
+                rolling_stats_max(fastest_stats),
+                rolling_stats_quantile(fastest_stats, STAT_P90));
+    }
+    wattrset(win, A_NORMAL);
+}
+
+// Precio de Bitcoin y costo estimado de una transacción típica
+static void draw_prices_panel(WINDOW *win, const FeeMetrics *m) {
+    werase(win);
+    if (m->btc_price_usd <= 0) return;
+    
+    wattrset(win, COLOR_PAIR(4) | A_BOLD);
+    mvwprintw(win, 0, 2, "Precio BTC: $%.2f USD | %.2f EUR", 
+            m->btc_price_usd, 
+            m->btc_price_eur);
+    
+    // Calcular y mostrar el costo en USD para una transacción típica (vsize = 250 bytes)
+    double avg_fee_sat = (m->fastest_fee + m->half_hour_fee) / 2.0;
+    double fee_btc = (avg_fee_sat * 250) / 100000000.0; // Convertir a BTC
+    double fee_usd = fee_btc * m->btc_price_usd;
+    double fee_eur = fee_btc * m->btc_price_eur;
+    
+    mvwprintw(win, 1, 2, "Costo estimado (250vB): $%.2f USD | %.2f EUR", fee_usd, fee_eur);
+    wattrset(win, A_NORMAL);
+}
+
+// Vacía las columnas y las alinea para que la última contenga `newest`
+static int trend_columns_reset(TrendColumns *trend, int count, int64_t newest) {
+    if (trend->count != count) {
+        TrendColumn *columns = realloc(trend->columns, (size_t)count * CLI_FEE_TIERS * sizeof(TrendColumn));
+        if (columns) trend->columns = columns;
+        int *samples = realloc(trend->samples, (size_t)count * sizeof(int));
+        if (samples) trend->samples = samples;
+        if (!columns || !samples) {
+            trend->valid = 0;
+            return 0;
+        }
+        trend->count = count;
+    }
     
-    // Fastest fee (10 min)
-    attron(COLOR_PAIR(3) | A_BOLD);
-    mvprintw(y, 2, "RÁPIDO (10 min):");
-    for (int i = 0; i < fastest_width; i++) {
-        mvaddch(y, 25 + i, ' ' | A_REVERSE);
+    trend->bucket_seconds = (HISTORY_SECONDS + count - 1) / count;
+    trend->first_bucket = newest / trend->bucket_seconds - count + 1;
+    trend->first_bucket -= trend->first_bucket & 1;
+    trend->last_timestamp = INT64_MIN;
+    trend->max_fee = 0;
+    trend->dirty_from = 0;
+    trend->valid = 1;
+    memset(trend->samples, 0, (size_t)count * sizeof(int));
+    return 1;
+}
+
+// Añade una muestra a su columna, desplazando el gráfico si hace falta
+static void trend_columns_add(TrendColumns *trend, const FeeHistoryPoint *point) {
+    int64_t bucket = point->timestamp / trend->bucket_seconds;
+    if (bucket < trend->first_bucket) return;
+    
+    // Desplazamiento en celdas enteras para no mover medio carácter
+    int64_t overflow = bucket - (trend->first_bucket + trend->count - 1);
+    if (overflow > 0) {
+        overflow += overflow & 1;
+        if (overflow >= trend->count) {
+            memset(trend->samples, 0, (size_t)trend->count * sizeof(int));
+        } else {
+            int keep = trend->count - (int)overflow;
+            memmove(trend->columns, trend->columns + overflow * CLI_FEE_TIERS,
+                    (size_t)keep * CLI_FEE_TIERS * sizeof(TrendColumn));
+            memmove(trend->samples, trend->samples + overflow, (size_t)keep * sizeof(int));
+            memset(trend->samples + keep, 0, (size_t)overflow * sizeof(int));
+        }
+        trend->first_bucket += overflow;
+        trend->dirty_from = 0;
     }
-    mvprintw(y, 25 + max_bar_width + 2, "%.1f sat/vB", fee_data->fastestFee);
     
-    // Half hour fee
-    attron(COLOR_PAIR(2) | A_BOLD);
-    mvprintw(y + 2, 2, "MEDIO (30 min):");
-    for (int i = 0; i < half_hour_width; i++) {
-        mvaddch(y + 2, 25 + i, ' ' | A_REVERSE);
+    int index = (int)(bucket - trend->first_bucket);
+    double values[CLI_FEE_TIERS] = { point->fastest, point->halfHour, point->hour };
+    for (int t = 0; t < CLI_FEE_TIERS; t++) {
+        TrendColumn *column = &trend->columns[index * CLI_FEE_TIERS + t];
+        if (trend->samples[index] == 0) {
+            column->first = column->low = column->high = values[t];
+        }
+        column->last = values[t];
+        column->low = fmin(column->low, values[t]);
+        column->high = fmax(column->high, values[t]);
+    }
+    trend->samples[index]++;
+    trend->last_timestamp = point->timestamp;
+    if (index < trend->dirty_from) trend->dirty_from = index;
+}
+
+// Gráfico de tendencia si hay suficiente historial y está habilitado
+static void draw_trend_panel(WINDOW *win, FeeData *fee_data) {
+    BrailleCanvas *canvas = &screen.trend_canvas;
+    TrendColumns *trend = &screen.trend_columns;
+    const FeeHistory *history = &fee_data->history;
+    size_t size = fee_history_size(history);
+    int rows = getmaxy(win) - 1;
+    int cols = getmaxx(win) - 20;
+    
+    if (!show_history || size < 2 || rows < 3 || cols < 2) {
+        werase(win);
+        braille_canvas_invalidate(canvas);
+        return;
     }
-    mvprintw(y + 2, 25 + max_bar_width + 2, "%.1f sat/vB", fee_data->halfHourFee);
     
-    // Hour fee
-    attron(COLOR_PAIR(1) | A_BOLD);
-    mvprintw(y + 4, 2, "LENTO (60 min):");
-    for (int i = 0; i < hour_width; i++) {
-        mvaddch(y + 4, 25 + i, ' ' | A_REVERSE);
+    if ((canvas->cols != cols || canvas->rows != rows) &&
+        !braille_canvas_resize(canvas, cols, rows)) {
+        return;
     }
-    mvprintw(y + 4, 25 + max_bar_width + 2, "%.1f sat/vB", fee_data->hourFee);
     
-    // Draw scale
-    attron(COLOR_PAIR(4) | A_DIM);
-    mvprintw(y + 6, 25, "0");
-    mvprintw(y + 6, 25 + (max_bar_width / 2), "%.0f", max_fee / 2);
-    mvprintw(y + 6, 25 + max_bar_width - 3, "%.0f", max_fee);
-    
-    // Mostrar precios de Bitcoin
-    attron(COLOR_PAIR(4) | A_BOLD);
-    if (fee_data->btc_price_usd > 0) {
-        mvprintw(y + 8, 2, "Precio BTC: $%.2f USD | %.2f EUR", 
-                fee_data->btc_price_usd, 
-                fee_data->btc_price_eur);
+    // Un lienzo nuevo o invalidado se dibuja sobre el panel vacío con las
+    // columnas rehechas desde el último día del anillo; si no, solo se añaden
+    // las muestras nuevas y se reescriben las celdas que cambian
+    size_t first;
+    if (!canvas->valid || !trend->valid) {
+        const FeeHistoryPoint *newest = fee_history_point(history, size - 1);
+        if (!trend_columns_reset(trend, cols * BRAILLE_CELL_WIDTH, newest->timestamp)) return;
+        first = fee_history_lower_bound(history, (time_t)(trend->first_bucket * trend->bucket_seconds));
         
-        // Calcular y mostrar el costo en USD para una transacción típica (vsize = 250 bytes)
-        double avg_fee_sat = (fee_data->fastestFee + fee_data->halfHourFee) / 2.0;
-        double fee_btc = (avg_fee_sat * 250) / 100000000.0; // Convertir a BTC
-        double fee_usd = fee_btc * fee_data->btc_price_usd;
-        double fee_eur = fee_btc * fee_data->btc_price_eur;
-        
-        mvprintw(y + 9, 2, "Costo estimado (250vB): $%.2f USD | %.2f EUR", fee_usd, fee_eur);
+        braille_canvas_invalidate(canvas);
+        werase(win);
+        wattrset(win, COLOR_PAIR(4) | A_BOLD);
+        mvwprintw(win, 0, 2, "Tendencia de tarifas (últimas 24 h):");
+        wattrset(win, A_NORMAL);
+    } else {
+        first = fee_history_lower_bound(history, (time_t)(trend->last_timestamp + 1));
     }
     
-    // Dibujar gráfico de tendencia si hay suficiente historial y está habilitado
-    if (show_history && fee_data->history.size > 1) {
-        int graph_y = y + 11;
-        int graph_height = 10;
-        if (graph_y + graph_height < max_y - 6) {  // Asegurar que haya espacio
-            mvprintw(graph_y - 1, 2, "Tendencia de tarifas (últimas horas):");
-            draw_trend_graph(stdscr, &fee_data->history, graph_y, 10, graph_height, max_x - 20);
-        }
+    for (size_t i = first; i < size; i++) {
+        trend_columns_add(trend, fee_history_point(history, i));
+    }
+    draw_trend_graph(win, canvas, trend, 1, 10);
+}
+
+// Ayuda, contador de actualización, avisos y controles
+static void draw_footer_panel(WINDOW *win) {
+    werase(win);
+    wattrset(win, COLOR_PAIR(4) | A_DIM);
+    
+    if (screen.message[0]) {
+        mvwprintw(win, 0, 2, "%s", screen.message);
+    } else {
+        mvwprintw(win, 0, 2, "Las tarifas están en satoshis por vbyte (sat/vB)");
+    }
+    char time_str[32];
+    strftime(time_str, sizeof(time_str), "%H:%M:%S", localtime(&screen.next_update));
+    mvwprintw(win, 1, 2, "Próxima actualización: %s", time_str);
+    mvwprintw(win, 2, 2, "q:Salir   r:Actualizar   ↑↓:Ajustar intervalo   h:Alternar historial   s:Cambiar fuente   e:Exportar");
+    wattrset(win, A_NORMAL);
+}
+
+// Draw the fee visualization: redraw only the panels whose data changed and
+// send the result to the terminal in a single update
+void draw_fee_visualization(FeeData *fee_data) {
+    const FeeSnapshot *snapshot = fee_data->snapshot;
+    
+    // La cabecera cambia con cada refresco (secuencia, latencia, hora) y con
+    // el estado de la descarga
+    if (fee_data->fetch_revision != screen.header_fetch_revision ||
+        (snapshot && snapshot->sequence != screen.header_sequence)) {
+        screen.dirty |= 1u << PANEL_HEADER;
+    }
+    
+    // Sin datos todavía solo hay cabecera y pie
+    unsigned drawable = snapshot ? (1u << PANEL_COUNT) - 1
+                                 : (1u << PANEL_HEADER) | (1u << PANEL_FOOTER);
+    
+    // Barras y precios solo cambian con una versión nueva o al registrar la muestra
+    if (snapshot && (snapshot->version != screen.bars_version ||
+                     fee_data->recorded_version != screen.bars_recorded)) {
+        screen.dirty |= 1u << PANEL_BARS;
+    }
+    if (snapshot && snapshot->version != screen.prices_version) {
+        screen.dirty |= 1u << PANEL_PRICES;
+    }
+    if (fee_data->recorded_version != screen.trend_recorded || show_history != screen.trend_visible) {
+        screen.dirty |= 1u << PANEL_TREND;
     }
+    if (screen.message[0] && time(NULL) >= screen.message_until) {
+        screen.message[0] = '\0';
+        screen.dirty |= 1u << PANEL_FOOTER;
+    }
+    
+    if (!(screen.dirty & drawable)) return;
     
-    // Draw footer
-    attron(COLOR_PAIR(4) | A_DIM);
-    mvprintw(max_y - 2, 2, "q:Salir   r:Actualizar   ↑↓:Ajustar intervalo   h:Alternar historial");
+    for (int i = 0; i < PANEL_COUNT; i++) {
+        WINDOW *win = screen.panels[i];
+        if (!(screen.dirty & drawable & (1u << i)) || !win) continue;
+        
+        switch (i) {
+        case PANEL_HEADER:
+            draw_header_panel(win, fee_data);
+            break;
+        case PANEL_BARS:
+            draw_bars_panel(win, fee_data);
+            break;
+        case PANEL_PRICES:
+            draw_prices_panel(win, &snapshot->metrics);
+            break;
+        case PANEL_TREND:
+            draw_trend_panel(win, fee_data);
+            break;
+        case PANEL_FOOTER:
+            draw_footer_panel(win);
+            break;
+        }
+        wnoutrefresh(win);
+    }
     
-    // Add some help text
-    mvprintw(max_y - 4, 2, "Las tarifas están en satoshis por vbyte (sat/vB)");
+    screen.header_fetch_revision = fee_data->fetch_revision;
+    if (snapshot) {
+        screen.header_sequence = snapshot->sequence;
+        screen.bars_version = snapshot->version;
+        screen.bars_recorded = fee_data->recorded_version;
+        screen.prices_version = snapshot->version;
+        screen.trend_recorded = fee_data->recorded_version;
+        screen.trend_visible = show_history;
+    }
+    screen.dirty &= ~drawable;
     
-    refresh();
+    doupdate();
 }
 
-// Inicializar el historial de tarifas
-void init_fee_history(FeeHistory *history, int capacity) {
-    history->points = (FeeHistoryPoint *)malloc(capacity * sizeof(FeeHistoryPoint));
-    history->size = 0;
-    history->capacity = capacity;
-    history->current = 0;
+// Indica si la instantánea se sirvió desde la caché: su marca de tiempo es la
+// de otra lectura y no debe registrarse como una muestra nueva
+static int snapshot_from_cache(const FeeSnapshot *snapshot) {
+    return strcmp(snapshot->source, CACHE_SOURCE) == 0;
 }
 
-// Agregar un punto al historial
-void add_to_history(FeeHistory *history, double fastest, double halfHour, double hour) {
-    if (history->size < history->capacity) {
-        int index = history->size++;
-        history->points[index].fastest = fastest;
-        history->points[index].halfHour = halfHour;
-        history->points[index].hour = hour;
-        history->points[index].timestamp = time(NULL);
-    } else {
-        // Usar el índice actual para sobrescribir el punto más antiguo
-        int index = history->current;
-        history->points[index].fastest = fastest;
-        history->points[index].halfHour = halfHour;
-        history->points[index].hour = hour;
-        history->points[index].timestamp = time(NULL);
-        history->current = (history->current + 1) % history->capacity;
-    }
+// Registrar la instantánea actual en el historial y en las estadísticas.
+// Una versión ya registrada o servida desde la caché no se añade. Se
+// registra aunque el gráfico esté oculto.
+void record_fee_sample(FeeData *fee_data) {
+    const FeeSnapshot *snapshot = fee_data->snapshot;
+    if (snapshot_from_cache(snapshot)) return;
+    if (!fee_snapshot_changed(snapshot, fee_data->recorded_version)) return;
+    fee_data->recorded_version = snapshot->version;
+    
+    const FeeMetrics *m = &snapshot->metrics;
+    fee_history_add(&fee_data->history,
+                    m->fastest_fee,
+                    m->half_hour_fee,
+                    m->hour_fee,
+                    snapshot->timestamp);
+    
+    double values[CLI_FEE_TIERS] = {
+        m->fastest_fee,
+        m->half_hour_fee,
+        m->hour_fee
+    };
+    fee_stats_push(&fee_data->stats, (double)snapshot->timestamp, values, CLI_FEE_TIERS);
 }
 
-// Dibujar el gráfico de tendencia
-void draw_trend_graph(WINDOW *win, FeeHistory *history, int y, int x, int height, int width) {
-    if (history->size < 2) return;
-    
-    // Encontrar el valor máximo para escalar el gráfico
+// Panel y posición donde se escriben las celdas del gráfico
+typedef struct {
+    WINDOW *win;
+    int y, x;
+} TrendTarget;
+
+// Escribe una celda braille cambiada
+static void draw_trend_cell(void *user_data, int col, int row, const char *utf8, uint8_t color) {
+    const TrendTarget *target = user_data;
+    wattrset(target->win, COLOR_PAIR(color));
+    mvwaddstr(target->win, target->y + row, target->x + col, utf8[0] ? utf8 : " ");
+}
+
+// Dibujar el gráfico de tendencia. Cada celda tiene 2x4 puntos braille y
+// cada columna de puntos resume sus muestras con el mínimo y el máximo, de
+// modo que un día de historial cabe en 80 columnas sin perder picos. Solo se
+// vuelven a trazar las celdas desde la primera columna que cambió.
+void draw_trend_graph(WINDOW *win, BrailleCanvas *canvas, TrendColumns *trend, int y, int x) {
+    // La escala sale de los mismos resúmenes; si cambia se traza todo
     double max_fee = 0;
-    for (int i = 0; i < history->size; i++) {
-        if (history->points[i].fastest > max_fee) max_fee = history->points[i].fastest;
-        if (history->points[i].halfHour > max_fee) max_fee = history->points[i].halfHour;
-        if (history->points[i].hour > max_fee) max_fee = history->points[i].hour;
+    for (int c = 0; c < trend->count; c++) {
+        if (!trend->samples[c]) continue;
+        for (int t = 0; t < CLI_FEE_TIERS; t++) {
+            max_fee = fmax(max_fee, trend->columns[c * CLI_FEE_TIERS + t].high);
+        }
     }
-    
     if (max_fee <= 0) max_fee = 1;  // Evitar división por cero
+    if (max_fee != trend->max_fee) {
+        trend->max_fee = max_fee;
+        trend->dirty_from = 0;
+    }
     
-    // Dibujar el gráfico
-    for (int t = 0; t < 3; t++) {
-        int color_pair = t + 1;
-        wattron(win, COLOR_PAIR(color_pair));
+    if (trend->dirty_from < trend->count) {
+        int from_cell = trend->dirty_from / BRAILLE_CELL_WIDTH;
+        braille_canvas_clear_cells(canvas, from_cell, canvas->cols);
         
-        for (int i = 0; i < width - 1 && i < history->size - 1; i++) {
-            int idx1 = (history->current - i - 1 + history->capacity) % history->capacity;
-            int idx2 = (history->current - i - 2 + history->capacity) % history->capacity;
-            
-            if (idx1 < 0 || idx2 < 0 || idx1 >= history->size || idx2 >= history->size) continue;
-            
-            double fee1 = (t == 0) ? history->points[idx1].fastest :
-                         (t == 1) ? history->points[idx1].halfHour :
-                                   history->points[idx1].hour;
-                                   
-            double fee2 = (t == 0) ? history->points[idx2].fastest :
-                         (t == 1) ? history->points[idx2].halfHour :
-                                   history->points[idx2].hour;
-            
-            int y1 = y + height - 1 - (int)((fee1 / max_fee) * (height - 2));
-            int y2 = y + height - 1 - (int)((fee2 / max_fee) * (height - 2));
-            
-            // Asegurarse de que los valores estén dentro de los límites
-            y1 = (y1 < y) ? y : (y1 >= y + height) ? y + height - 1 : y1;
-            y2 = (y2 < y) ? y : (y2 >= y + height) ? y + height - 1 : y2;
-            
-            mvwaddch(win, y1, x + width - 2 - i, ACS_CKBOARD);
+        // Se empieza en la última columna con muestras anterior para trazar
+        // la unión con lo nuevo; sus puntos ya estaban en el lienzo
+        int start = from_cell * BRAILLE_CELL_WIDTH - 1;
+        while (start >= 0 && !trend->samples[start]) start--;
+        if (start < 0) start = from_cell * BRAILLE_CELL_WIDTH;
+        
+        // El rápido (color 3) queda encima donde se cruzan
+        for (int t = CLI_FEE_TIERS - 1; t >= 0; t--) {
+            BraillePlot plot;
+            braille_plot_begin(&plot, canvas, 0, trend->count - 1, 0, max_fee, (uint8_t)(3 - t));
             
-            // Dibujar línea entre puntos
-            if (y1 != y2) {
-                int step = (y2 > y1) ? 1 : -1;
-                for (int py = y1; py != y2; py += step) {
-                    mvwaddch(win, py, x + width - 2 - i, ACS_VLINE);
-                }
+            for (int c = start; c < trend->count; c++) {
+                if (!trend->samples[c]) continue;
+                const TrendColumn *column = &trend->columns[c * CLI_FEE_TIERS + t];
+                braille_plot_point(&plot, c, column->first);
+                braille_plot_point(&plot, c, column->low);
+                braille_plot_point(&plot, c, column->high);
+                braille_plot_point(&plot, c, column->last);
             }
+            braille_plot_end(&plot);
         }
-        
-        wattroff(win, COLOR_PAIR(color_pair));
+        trend->dirty_from = trend->count;
     }
     
+    TrendTarget target = { win, y, x };
+    braille_canvas_flush(canvas, draw_trend_cell, &target);
+    
+    // Escala
+    wattrset(win, COLOR_PAIR(4) | A_DIM);
+    mvwprintw(win, y, 1, "%7.1f", max_fee);
+    mvwprintw(win, y + canvas->rows - 1, 1, "%7.1f", 0.0);
+    
     // Leyenda
-    wattron(win, COLOR_PAIR(3));
-    mvwprintw(win, y, x + 5, "F: Rápido");
-    wattron(win, COLOR_PAIR(2));
-    mvwprintw(win, y, x + 15, "M: Medio");
-    wattron(win, COLOR_PAIR(1));
-    mvwprintw(win, y, x + 25, "L: Lento");
-    wattroff(win, COLOR_PAIR(1));
+    wattrset(win, COLOR_PAIR(3));
+    mvwprintw(win, y, x + canvas->cols + 1, "F: Rápido");
+    wattrset(win, COLOR_PAIR(2));
+    mvwprintw(win, y + 1, x + canvas->cols + 1, "M: Medio");
+    wattrset(win, COLOR_PAIR(1));
+    mvwprintw(win, y + 2, x + canvas->cols + 1, "L: Lento");
+    wattrset(win, A_NORMAL);
 }
 
-int main() {
-    // Initialize ncurses
-    init_screen();
-    
-    FeeData current_fees = {0};
-    init_fee_history(&current_fees.history, 60); // Mantener 60 puntos de historial (1 por minuto)
-    int ch;
-    time_t last_update = 0;
-    const int UPDATE_INTERVAL = 30; // segundos entre actualizaciones
-    int seconds_until_update = 0;
-    
-    // Initial fetch
-    if (!fetch_fee_data(&current_fees)) {
-        endwin();
-        fprintf(stderr, "Error al obtener los datos de tarifas.\n");
-        return 1;
-    }
-    last_update = time(NULL);
-    
-    // Main loop
-    while (1) {
-        time_t now = time(NULL);
-        seconds_until_update = UPDATE_INTERVAL - (now - last_update);
+// Descriptores que vigila el bucle principal
+enum {
+    LOOP_STDIN,     // Teclado
+    LOOP_TIMER,     // Próxima actualización programada
+    LOOP_SIGNAL,    // SIGWINCH
+    LOOP_FETCH,     // Resultados del hilo de descarga
+    LOOP_FDS
+};
+
+// Programa la próxima actualización dentro de `seconds` segundos
+static void schedule_refresh(int timer_fd, int seconds) {
+    struct itimerspec spec = {0};
+    spec.it_value.tv_sec = seconds > 0 ? seconds : 1;
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+    screen_set_next_update(time(NULL) + spec.it_value.tv_sec);
+}
+
+// Pide una descarga al hilo. Las actualizaciones se descartan si ya hay una en
+// curso; los cambios de fuente se encolan dejando sitio para la salida.
+static void request_fetch(FeeData *fee_data, FetchCommand command) {
+    if (command != FETCH_NEXT_SOURCE && fee_data->fetch_pending > 0) return;
+    if (fee_data->fetch_pending >= FETCH_QUEUE_CAPACITY - 1) return;
+    if (!fetcher_request(&fetcher, command)) return;
+    
+    fee_data->fetch_pending++;
+    fee_data->fetch_revision++;
+}
+
+// Aplica los resultados publicados por el hilo de descarga
+static void handle_fetch_results(FeeData *fee_data, int timer_fd, int update_interval, int retry_interval) {
+    uint64_t count;
+    if (read(fetcher.result_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) return;
+    
+    FetchResult result;
+    while (spsc_queue_pop(&fetcher.results, &result)) {
+        fee_data->fetch_pending--;
+        fee_data->fetch_failed = result.snapshot == NULL;
+        fee_data->fetch_latency_ms = result.latency_ms;
+        memcpy(fee_data->fetch_source, result.source, sizeof(fee_data->fetch_source));
+        fee_data->fetch_revision++;
         
-        // Actualizar si ha pasado el intervalo
-        if (seconds_until_update <= 0) {
-            if (fetch_fee_data(&current_fees)) {
-                // Agregar al historial
-                if (show_history) {
-                    add_to_history(&current_fees.history, 
-                                 current_fees.fastestFee, 
-                                 current_fees.halfHourFee, 
-                                 current_fees.hourFee);
-                }
-                // Exportar automáticamente a CSV
-                export_data_to_csv(&current_fees, "btc_fees_log.csv");
-                last_update = now;
-                seconds_until_update = UPDATE_INTERVAL;
-            } else {
-                // Si falla, reintentar en 5 segundos
-                seconds_until_update = 5;
-            }
+        if (!result.snapshot) {
+            // Si falla, reintentar en unos segundos
+            schedule_refresh(timer_fd, retry_interval);
+            continue;
         }
         
-        // Actualizar la pantalla con el contador
-        draw_fee_visualization(&current_fees);
-        
-        // Mostrar información de la fuente actual
-        int max_y = getmaxy(stdscr);
-        mvprintw(3, 2, "Fuente: %s | ", data_sources[current_source].name);
-        printw("Tiempo real");
-        
-        // Mostrar contador de actualización
-        mvprintw(max_y - 3, 2, "Próxima actualización: %d segundos ", seconds_until_update);
-        
-        // Mostrar controles
-        mvprintw(max_y - 2, 2, "q:Salir   r:Actualizar   ↑↓:Ajustar intervalo   h:Alternar historial   s:Cambiar fuente   e:Exportar");
-        
-        // Esperar entrada del usuario con timeout (no bloqueante)
-        nodelay(stdscr, TRUE);
-        ch = getch();
+        // Publicar la instantánea (el resultado ya trae su referencia)
+        fee_snapshot_unref(fee_data->snapshot);
+        fee_data->snapshot = result.snapshot;
         
+        // Agregar al historial (el cambio de fuente solo actualiza la vista)
+        if (result.command != FETCH_NEXT_SOURCE) {
+            record_fee_sample(fee_data);
+        }
+        // Exportar automáticamente a CSV (solo versiones nuevas leídas de la red)
+        if (result.command == FETCH_SCHEDULED && !snapshot_from_cache(fee_data->snapshot) &&
+            fee_snapshot_changed(fee_data->snapshot, fee_data->exported_version)) {
+            export_data_to_csv(fee_data->snapshot, "btc_fees_log.csv");
+            fee_data->exported_version = fee_data->snapshot->version;
+        }
+        schedule_refresh(timer_fd, update_interval);
+    }
+}
+
+// Ajusta ncurses al nuevo tamaño del terminal y recrea los paneles
+static void handle_resize(void) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        resizeterm(ws.ws_row, ws.ws_col);
+    }
+    screen_layout();
+}
+
+// Atiende las teclas pendientes. Devuelve 0 si el usuario pidió salir.
+static int handle_keys(FeeData *fee_data) {
+    int ch;
+    while ((ch = getch()) != ERR) {
         if (ch == 'q' || ch == 'Q') {
-            break;
-        } else if (ch == 'r' || ch == 'R' || ch == KEY_RESIZE) {
-            // Actualizar manualmente o redimensionar ventana
-            if (fetch_fee_data(&current_fees)) {
-                if (show_history) {
-                    add_to_history(&current_fees.history, 
-                                 current_fees.fastestFee, 
-                                 current_fees.halfHourFee, 
-                                 current_fees.hourFee);
-                }
-                last_update = time(NULL);
-            }
+            return 0;
+        } else if (ch == KEY_RESIZE) {
+            // Recrear los paneles con el nuevo tamaño
+            screen_layout();
+        } else if (ch == 'r' || ch == 'R') {
+            // Actualizar manualmente; el intervalo se reinicia al llegar el resultado
+            request_fetch(fee_data, FETCH_MANUAL);
         } else if (ch == 'h' || ch == 'H') {
-            // Alternar visualización del historial
+            // Alternar visualización del historial (el panel se redibuja solo)
             show_history = !show_history;
-            clear();
         } else if (ch == 's' || ch == 'S') {
             // Cambiar a la siguiente fuente de datos
-            cycle_data_source();
-            // Actualizar la pantalla para mostrar la nueva fuente
-            continue;
+            request_fetch(fee_data, FETCH_NEXT_SOURCE);
         } else if (ch == 'e' || ch == 'E') {
             // Exportar datos
-            char filename[256];
+            char filename[64];  // btc_fees_export_AAAAMMDD_HHMMSS.csv
             time_t now = time(NULL);
             struct tm *tm_now = localtime(&now);
             strftime(filename, sizeof(filename), "btc_fees_export_%Y%m%d_%H%M%S.csv", tm_now);
             
             // Exportar historial
-            export_history_to_csv(&current_fees.history, filename);
+            export_history_to_csv(&fee_data->history, filename);
+            
+            // Mostrar mensaje de confirmación en el pie durante unos segundos
+            char message[sizeof(screen.message)];
+            snprintf(message, sizeof(message), "Datos exportados a %s", filename);
+            screen_show_message(message);
+        }
+    }
+    return 1;
+}
+
+// Opciones de la línea de órdenes
+typedef struct {
+    int daemon;                 // Sin pantalla: instantáneas como JSON Lines
+    int interval;               // Segundos entre actualizaciones
+    const char *output_path;    // Archivo de salida (NULL o "-" = stdout)
+    const char *socket_path;    // Socket Unix de escucha (opcional)
+    const char *store_path;     // Base de datos (NULL = ruta por defecto)
+    int use_store;
+    const char *history_path;   // Anillo del historial (NULL = ruta por defecto)
+    long history_capacity;      // Puntos del historial (0 = la del archivo)
+} CliOptions;
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Uso: %s [opciones]\n"
+            "  -d, --daemon, --headless  Sin pantalla: emite cada instantánea como JSON Lines\n"
+            "  -o, --output RUTA         Archivo de salida del modo sin pantalla (por defecto stdout)\n"
+            "  -S, --socket RUTA         Publica también las líneas en un socket Unix\n"
+            "      --store RUTA          Base de datos SQLite (por defecto ~/.local/share/btc-fee-tracker/data.db)\n"
+            "      --no-store            No guardar en la base de datos\n"
+            "      --history RUTA        Archivo del historial (por defecto ~/.local/share/btc-fee-tracker/history.ring)\n"
+            "      --history-size PUNTOS Cambia la capacidad del historial (al crearlo: un día; máximo %zu)\n"
+            "  -i, --interval SEGUNDOS   Intervalo entre actualizaciones (por defecto %d)\n"
+            "  -h, --help                Muestra esta ayuda\n",
+            program, FEE_HISTORY_MAX_CAPACITY, DEFAULT_UPDATE_INTERVAL);
+}
+
+// Lee las opciones. Devuelve 0 si son incorrectas o se pidió la ayuda.
+static int parse_options(int argc, char **argv, CliOptions *options) {
+    static const struct option long_options[] = {
+        { "daemon",   no_argument,       NULL, 'd' },
+        { "headless", no_argument,       NULL, 'd' },
+        { "output",   required_argument, NULL, 'o' },
+        { "socket",   required_argument, NULL, 'S' },
+        { "store",    required_argument, NULL, 's' },
+        { "no-store", no_argument,       NULL, 'n' },
+        { "history",  required_argument, NULL, 'H' },
+        { "history-size", required_argument, NULL, 'c' },
+        { "interval", required_argument, NULL, 'i' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    
+    memset(options, 0, sizeof(*options));
+    options->interval = DEFAULT_UPDATE_INTERVAL;
+    options->use_store = 1;
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "do:S:i:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'd': options->daemon = 1; break;
+        case 'o': options->output_path = optarg; break;
+        case 'S': options->socket_path = optarg; break;
+        case 's': options->store_path = optarg; break;
+        case 'n': options->use_store = 0; break;
+        case 'H': options->history_path = optarg; break;
+        case 'c':
+            options->history_capacity = atol(optarg);
+            if (options->history_capacity < 2 || (size_t)options->history_capacity > FEE_HISTORY_MAX_CAPACITY) {
+                fprintf(stderr, "Capacidad del historial no válida: %s\n", optarg);
+                return 0;
+            }
+            break;
+        case 'i':
+            options->interval = atoi(optarg);
+            if (options->interval < 1) {
+                fprintf(stderr, "Intervalo no válido: %s\n", optarg);
+                return 0;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Destinos de las líneas del modo sin pantalla
+typedef struct {
+    const char *output_path;    // NULL = stdout
+    int output_fd;
+    const char *socket_path;
+    int listen_fd;              // -1 sin socket
+    int clients[DAEMON_MAX_CLIENTS];
+    int client_count;
+} DaemonSinks;
+
+// Abre (o reabre, tras una rotación con SIGHUP) el archivo de salida
+static int daemon_open_output(DaemonSinks *sinks) {
+    if (!sinks->output_path) {
+        sinks->output_fd = STDOUT_FILENO;
+        return 1;
+    }
+    
+    int fd = open(sinks->output_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "No se pudo abrir %s: %s\n", sinks->output_path, strerror(errno));
+        return 0;
+    }
+    if (sinks->output_fd > STDERR_FILENO) close(sinks->output_fd);
+    sinks->output_fd = fd;
+    return 1;
+}
+
+// Crea el socket Unix de escucha, sustituyendo uno abandonado
+static int daemon_listen(DaemonSinks *sinks) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(sinks->socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Ruta de socket demasiado larga: %s\n", sinks->socket_path);
+        return 0;
+    }
+    strcpy(addr.sun_path, sinks->socket_path);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return 0;
+    
+    unlink(sinks->socket_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, DAEMON_MAX_CLIENTS) != 0) {
+        fprintf(stderr, "No se pudo escuchar en %s: %s\n", sinks->socket_path, strerror(errno));
+        close(fd);
+        return 0;
+    }
+    sinks->listen_fd = fd;
+    return 1;
+}
+
+// Acepta los clientes pendientes; los que no caben se cierran
+static void daemon_accept(DaemonSinks *sinks) {
+    int fd;
+    while ((fd = accept4(sinks->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (sinks->client_count == DAEMON_MAX_CLIENTS) {
+            close(fd);
+            continue;
+        }
+        sinks->clients[sinks->client_count++] = fd;
+    }
+}
+
+// Escribe un bloque completo en un descriptor bloqueante
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return 1;
+}
+
+// Envía una línea a la salida y a cada cliente. Un cliente que no acepta la
+// línea completa sin bloquear se desconecta: nunca se acumula memoria por él.
+static void daemon_emit(DaemonSinks *sinks, const char *line, size_t len) {
+    if (!write_all(sinks->output_fd, line, len)) {
+        fprintf(stderr, "Error al escribir la salida: %s\n", strerror(errno));
+    }
+    
+    for (int i = 0; i < sinks->client_count; ) {
+        ssize_t sent = send(sinks->clients[i], line, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent == (ssize_t)len) {
+            i++;
+            continue;
+        }
+        close(sinks->clients[i]);
+        sinks->clients[i] = sinks->clients[--sinks->client_count];
+    }
+}
+
+static void daemon_close_sinks(DaemonSinks *sinks) {
+    for (int i = 0; i < sinks->client_count; i++) {
+        close(sinks->clients[i]);
+    }
+    sinks->client_count = 0;
+    if (sinks->listen_fd >= 0) {
+        close(sinks->listen_fd);
+        unlink(sinks->socket_path);
+    }
+    if (sinks->output_fd > STDERR_FILENO) close(sinks->output_fd);
+}
+
+// Número JSON con los decimales indicados; los valores no finitos no son JSON
+// válido y se escriben como null
+static const char *json_number(char *buffer, size_t size, double value, int decimals) {
+    if (!isfinite(value)) return "null";
+    snprintf(buffer, size, "%.*f", decimals, value);
+    return buffer;
+}
+
+// Serializa una instantánea como una línea JSON sin reservar memoria. Los
+// nombres de fuente son constantes del programa y no necesitan escape.
+static size_t format_snapshot_jsonl(const FeeSnapshot *snapshot, char *line, size_t size) {
+    const FeeMetrics *m = &snapshot->metrics;
+    char num[8][32];
+    int len = snprintf(line, size,
+            "{\"timestamp\":%lld,\"sequence\":%llu,\"version\":%llu,\"source\":\"%s\","
+            "\"latency_ms\":%s,\"fastest_fee\":%s,\"half_hour_fee\":%s,\"hour_fee\":%s,"
+            "\"economy_fee\":%s,\"minimum_fee\":%s,\"btc_usd\":%s,\"btc_eur\":%s,"
+            "\"mempool_tx_count\":%lld,\"mempool_vsize\":%lld",
+            (long long)snapshot->timestamp,
+            (unsigned long long)snapshot->sequence,
+            (unsigned long long)snapshot->version,
+            snapshot->source,
+            json_number(num[0], sizeof(num[0]), snapshot->latency_ms, 0),
+            json_number(num[1], sizeof(num[1]), m->fastest_fee, 1),
+            json_number(num[2], sizeof(num[2]), m->half_hour_fee, 1),
+            json_number(num[3], sizeof(num[3]), m->hour_fee, 1),
+            json_number(num[4], sizeof(num[4]), m->economy_fee, 1),
+            json_number(num[5], sizeof(num[5]), m->minimum_fee, 1),
+            json_number(num[6], sizeof(num[6]), m->btc_price_usd, 2),
+            json_number(num[7], sizeof(num[7]), m->btc_price_eur, 2),
+            (long long)m->mempool_tx_count, (long long)m->mempool_vsize);
+    
+    // Tarifa por objetivo de confirmación (1, 3 y 6 bloques) si hay profundidad
+    if (len > 0 && (size_t)len < size && snapshot->depth) {
+        char target[3][32];
+        len += snprintf(line + len, size - len, ",\"target_fees\":[%s,%s,%s]",
+                json_number(target[0], sizeof(target[0]), mempool_depth_fee_for_target(snapshot->depth, 1), 1),
+                json_number(target[1], sizeof(target[1]), mempool_depth_fee_for_target(snapshot->depth, 3), 1),
+                json_number(target[2], sizeof(target[2]), mempool_depth_fee_for_target(snapshot->depth, 6), 1));
+    }
+    if (len < 0 || (size_t)len + 2 >= size) return 0;
+    
+    line[len++] = '}';
+    line[len++] = '\n';
+    line[len] = '\0';
+    return (size_t)len;
+}
+
+// Aplica los resultados del hilo de descarga en el modo sin pantalla: solo
+// las lecturas con una versión nueva se emiten y se guardan en la base de datos
+static void daemon_handle_results(FeeData *fee_data, DaemonSinks *sinks, FeeStore *store,
+                                  int timer_fd, int interval) {
+    uint64_t count;
+    if (read(fetcher.result_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) return;
+    
+    FetchResult result;
+    while (spsc_queue_pop(&fetcher.results, &result)) {
+        fee_data->fetch_pending--;
+        
+        if (!result.snapshot) {
+            fprintf(stderr, "Sin respuesta de ninguna fuente (última: %s, %.0f ms)\n",
+                    result.source, result.latency_ms);
+            schedule_refresh(timer_fd, RETRY_INTERVAL);
+            continue;
+        }
+        
+        if (fee_snapshot_changed(result.snapshot, fee_data->recorded_version)) {
+            char line[JSONL_LINE_MAX];
+            size_t len = format_snapshot_jsonl(result.snapshot, line, sizeof(line));
+            if (len > 0) daemon_emit(sinks, line, len);
             
-            // Mostrar mensaje de confirmación
-            mvprintw(max_y - 4, 2, "Datos exportados a %s", filename);
-            refresh();
-            napms(2000); // Mostrar mensaje por 2 segundos
+            if (store) fee_store_append(store, result.snapshot);
+        }
+        fee_data->recorded_version = result.snapshot->version;
+        
+        fee_snapshot_unref(fee_data->snapshot);
+        fee_data->snapshot = result.snapshot;
+        schedule_refresh(timer_fd, interval);
+    }
+}
+
+// Descriptores que vigila el bucle del modo sin pantalla
+enum {
+    DAEMON_TIMER,
+    DAEMON_FETCH,
+    DAEMON_SIGNAL,
+    DAEMON_LISTEN,
+    DAEMON_FDS
+};
+
+// Modo sin pantalla: el mismo planificador y el mismo hilo de descarga (con
+// sus fuentes de respaldo) que la vista ncurses, sin ncurses. Todo el estado
+// es de tamaño fijo, así que la memoria no crece con el tiempo.
+static int run_daemon(const CliOptions *options) {
+    // SIGINT/SIGTERM terminan limpiamente y SIGHUP reabre la salida (rotación)
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (signal_fd < 0 || timer_fd < 0) {
+        fprintf(stderr, "Error al crear los descriptores del bucle: %s\n", strerror(errno));
+        return 1;
+    }
+    
+    DaemonSinks sinks = { .listen_fd = -1 };
+    if (options->output_path && strcmp(options->output_path, "-") != 0) {
+        sinks.output_path = options->output_path;
+    }
+    sinks.socket_path = options->socket_path;
+    if (!daemon_open_output(&sinks) || (sinks.socket_path && !daemon_listen(&sinks))) {
+        return 1;
+    }
+    
+    FeeStore store;
+    FeeStore *active_store = NULL;
+    if (options->use_store) {
+        char default_path[1024];
+        const char *path = options->store_path;
+        if (!path && fee_store_default_path(default_path, sizeof(default_path))) path = default_path;
+        if (path && fee_store_open(&store, path)) {
+            active_store = &store;
+        } else {
+            fprintf(stderr, "Continuando sin base de datos\n");
+        }
+    }
+    
+    // cJSON reserva desde la arena del ciclo cuando hay una asociada
+    arena_init(&fetch_arena, FETCH_ARENA_CHUNK);
+    cJSON_Hooks hooks = { arena_hook_malloc, arena_hook_free };
+    cJSON_InitHooks(&hooks);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    
+    // El hilo hereda la máscara con las señales bloqueadas; cada tick va a la red
+    if (!fetcher_start(&fetcher, 0)) {
+        fprintf(stderr, "Error al iniciar el hilo de descarga: %s\n", strerror(errno));
+        return 1;
+    }
+    
+    FeeData fee_data = {0};
+    request_fetch(&fee_data, FETCH_SCHEDULED);
+    
+    struct pollfd fds[DAEMON_FDS] = {
+        [DAEMON_TIMER] = { .fd = timer_fd, .events = POLLIN },
+        [DAEMON_FETCH] = { .fd = fetcher.result_fd, .events = POLLIN },
+        [DAEMON_SIGNAL] = { .fd = signal_fd, .events = POLLIN },
+        [DAEMON_LISTEN] = { .fd = sinks.listen_fd, .events = POLLIN },  // -1 se ignora
+    };
+    
+    int running = 1;
+    while (running) {
+        if (poll(fds, DAEMON_FDS, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        
+        if (fds[DAEMON_TIMER].revents & POLLIN) {
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                request_fetch(&fee_data, FETCH_SCHEDULED);
+            }
+            // Un lote antiguo se escribe aunque no lleguen filas nuevas
+            if (active_store) fee_store_flush_due(active_store, time(NULL));
         }
         
-        // Esperar 1 segundo antes de la siguiente iteración
-        sleep(1);
+        if (fds[DAEMON_FETCH].revents & POLLIN) {
+            daemon_handle_results(&fee_data, &sinks, active_store, timer_fd, options->interval);
+        }
+        
+        if (fds[DAEMON_LISTEN].revents & POLLIN) {
+            daemon_accept(&sinks);
+        }
+        
+        if (fds[DAEMON_SIGNAL].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                if (info.ssi_signo == SIGHUP) {
+                    daemon_open_output(&sinks);
+                    if (active_store) fee_store_flush(active_store);
+                } else {
+                    running = 0;
+                }
+            }
+        }
     }
     
     // Clean up
+    fetcher_stop(&fetcher);
+    if (active_store) fee_store_close(active_store);
+    daemon_close_sinks(&sinks);
+    close(timer_fd);
+    close(signal_fd);
+    fee_snapshot_unref(fee_data.snapshot);
+    arena_destroy(&fetch_arena);
+    curl_global_cleanup();
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    CliOptions options;
+    if (!parse_options(argc, argv, &options)) return 2;
+    if (options.daemon) return run_daemon(&options);
+    
+    const int UPDATE_INTERVAL = options.interval;
+    
+    // SIGWINCH se recibe por un descriptor: se bloquea antes de que ncurses
+    // instale su manejador para que el cambio de tamaño llegue al bucle
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGWINCH);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (signal_fd < 0 || timer_fd < 0) {
+        fprintf(stderr, "Error al crear los descriptores del bucle: %s\n", strerror(errno));
+        return 1;
+    }
+    
+    // El historial continúa donde lo dejó la ejecución anterior
+    FeeData current_fees = {0};
+    char history_path[4096];
+    if (!options.history_path && fee_history_default_path(history_path, sizeof(history_path))) {
+        options.history_path = history_path;
+    }
+    // Solo se cambia la capacidad de un anillo existente si se pide con
+    // --history-size; un anillo nuevo guarda un día de actualizaciones
+    int resize_history = options.history_capacity > 0;
+    size_t history_capacity = resize_history ? (size_t)options.history_capacity
+                                             : (size_t)(HISTORY_SECONDS / UPDATE_INTERVAL);
+    if (!fee_history_open(&current_fees.history, options.history_path, history_capacity, resize_history)) {
+        fprintf(stderr, "No hay memoria para el historial\n");
+        return 1;
+    }
+    fee_stats_init(&current_fees.stats, STATS_WINDOW, 0, STATS_EWMA_ALPHA);
+    
+    // cJSON reserva desde la arena del ciclo cuando hay una asociada
+    arena_init(&fetch_arena, FETCH_ARENA_CHUNK);
+    cJSON_Hooks hooks = { arena_hook_malloc, arena_hook_free };
+    cJSON_InitHooks(&hooks);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    
+    // El hilo hereda la máscara con SIGWINCH bloqueada
+    if (!fetcher_start(&fetcher, 1)) {
+        fprintf(stderr, "Error al iniciar el hilo de descarga: %s\n", strerror(errno));
+        return 1;
+    }
+    
+    // Initialize ncurses
+    init_screen();
+    
+    // Primera descarga: la pantalla muestra el estado mientras llega
+    request_fetch(&current_fees, FETCH_SCHEDULED);
+    
+    struct pollfd fds[LOOP_FDS] = {
+        [LOOP_STDIN] = { .fd = STDIN_FILENO, .events = POLLIN },
+        [LOOP_TIMER] = { .fd = timer_fd, .events = POLLIN },
+        [LOOP_SIGNAL] = { .fd = signal_fd, .events = POLLIN },
+        [LOOP_FETCH] = { .fd = fetcher.result_fd, .events = POLLIN },
+    };
+    
+    // Main loop: duerme hasta que hay una tecla, vence el temporizador, llega
+    // un resultado de descarga o cambia el tamaño del terminal
+    int running = 1;
+    while (running) {
+        // Solo se redibujan los paneles que cambiaron
+        draw_fee_visualization(&current_fees);
+        
+        if (poll(fds, LOOP_FDS, screen_message_timeout_ms()) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        
+        // Actualización programada (si ya hay una descarga en curso, su
+        // resultado reprograma el temporizador)
+        if (fds[LOOP_TIMER].revents & POLLIN) {
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                request_fetch(&current_fees, FETCH_SCHEDULED);
+            }
+        }
+        
+        // Resultados del hilo de descarga
+        if (fds[LOOP_FETCH].revents & POLLIN) {
+            handle_fetch_results(&current_fees, timer_fd, UPDATE_INTERVAL, RETRY_INTERVAL);
+        }
+        
+        // Cambio de tamaño del terminal
+        if (fds[LOOP_SIGNAL].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {}
+            handle_resize();
+        }
+        
+        // Teclado
+        if (fds[LOOP_STDIN].revents & POLLIN) {
+            running = handle_keys(&current_fees);
+        }
+        
+        // Entrada cerrada (terminal colgada o fin de una redirección): poll
+        // la seguiría marcando siempre, así que deja de vigilarse
+        if (fds[LOOP_STDIN].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+            fds[LOOP_STDIN].fd = -1;
+        }
+    }
+    
+    // Clean up: la terminal se restaura antes de esperar al hilo
+    screen_free();
     endwin();
+    fetcher_stop(&fetcher);
+    close(timer_fd);
+    close(signal_fd);
+    fee_history_close(&current_fees.history);
+    fee_stats_free(&current_fees.stats);
+    fee_snapshot_unref(current_fees.snapshot);
+    arena_destroy(&fetch_arena);
+    curl_global_cleanup();
     return 0;
 }
@@ -2,8 +2,10 @@
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <glib/gstdio.h>
 #include <pango/pangocairo.h>
+#include <cairo-svg.h>
 
 // Default colors
 static const GdkRGBA DEFAULT_COLORS[] = {
@@ -19,45 +21,208 @@ static const GdkRGBA DEFAULT_COLORS[] = {
 // Default padding
 #define CHART_PADDING 10
 
+// Point markers
+#define CHART_MARKER_RADIUS 3.0
+#define CHART_MARKER_MIN_SPACING 6.0  // Skip markers when points are denser than this (px)
+
+// Decimation: series with more than this many points per pixel column are reduced
+#define CHART_DECIMATION_POINTS_PER_COLUMN 4
+
+// Candle colors and body width relative to the interval
+static const GdkRGBA CANDLE_UP_COLOR = {0.30, 0.69, 0.31, 1.0};    // Green
+static const GdkRGBA CANDLE_DOWN_COLOR = {0.95, 0.26, 0.21, 1.0};  // Red
+#define CANDLE_BODY_RATIO 0.7
+
+// Text layouts kept per chart before the cache is flushed (axis labels change over time)
+#define CHART_TEXT_CACHE_MAX 256
+
+// Extra pixels replotted left of a dirty strip so line joins and markers stay whole
+#define CHART_DIRTY_PAD (CHART_MARKER_RADIUS + 2.0)
+
+// Y axis: target number of grid intervals, default padding and the smallest
+// value shown on a log scale
+#define CHART_Y_TICKS 5
+#define CHART_Y_PADDING 0.05
+#define CHART_LOG_MIN 1e-3
+
+// Y axis label font
+#define CHART_AXIS_FONT "Sans 8"
+
+// Hover tooltip: gap from the crosshair and inner padding
+#define CHART_HOVER_OFFSET 12
+#define CHART_HOVER_PADDING 6
+
+static void chart_invalidate_data_layer(ChartConfig *config);
+static void chart_autoscale_push(ChartConfig *config, double x, double y);
+static void chart_autoscale_invalidate(ChartConfig *config);
+static void chart_viewport_update(ChartViewport *viewport);
+static void chart_viewport_detach(ChartConfig *config);
+
+// Maps data y to widget y for one frame
+typedef struct {
+    double origin;     // Bottom of the range, in axis units
+    double scale;      // Pixels per axis unit
+    int height;
+    gboolean log;
+} ChartYMap;
+
+static void chart_y_map_init(ChartYMap *map, const ChartConfig *config, int height) {
+    map->log = config->log_scale;
+    map->height = height;
+    
+    double lo = config->min_y, hi = config->max_y;
+    if (map->log) {
+        lo = log10(MAX(lo, CHART_LOG_MIN));
+        hi = log10(MAX(hi, CHART_LOG_MIN));
+    }
+    map->origin = lo;
+    map->scale = hi > lo ? height / (hi - lo) : 0;
+}
+
+static inline double chart_y_map(const ChartYMap *map, double y) {
+    double v = map->log ? log10(MAX(y, CHART_LOG_MIN)) : y;
+    return map->height - (v - map->origin) * map->scale;
+}
+
+// Frame clock callback that performs a pending redraw
+static gboolean chart_tick_cb(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data) {
+    ChartConfig *config = (ChartConfig *)user_data;
+    
+    // The callback only lives while a redraw is pending
+    config->tick_id = 0;
+    if (config->dirty && gtk_widget_get_mapped(widget)) {
+        gtk_widget_queue_draw(widget);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+// Mark the chart dirty. The redraw happens on the next frame clock tick, at most
+// once per frame, and only while the widget is mapped (e.g. on the visible
+// notebook page); hidden charts just stay dirty until they are shown.
+void chart_redraw(ChartConfig *config) {
+    if (!config) return;
+    
+    config->dirty = TRUE;
+    
+    GtkWidget *area = config->drawing_area;
+    if (!area || config->tick_id != 0 || !gtk_widget_get_mapped(area)) return;
+    
+    config->tick_id = gtk_widget_add_tick_callback(area, chart_tick_cb, config, NULL);
+}
+
 // Get a color from the default palette
 static void get_default_color(int index, GdkRGBA *color) {
     *color = DEFAULT_COLORS[index % (sizeof(DEFAULT_COLORS) / sizeof(DEFAULT_COLORS[0]))];
 }
 
-// Create a new chart configuration
-ChartConfig* chart_config_new(GtkWidget *parent, const char *title) {
-    ChartConfig *config = g_new0(ChartConfig, 1);
+// Get a shaped layout for a string, reusing it across frames. `font` is a Pango
+// font description string, or NULL for the widget font. The layout is owned by
+// the cache and must not be modified or unreferenced by the caller.
+static PangoLayout* chart_text_layout(ChartConfig *config, cairo_t *cr, const char *text, const char *font) {
+    char *key = g_strconcat(font ? font : "", "|", text, NULL);
+    PangoLayout *layout = g_hash_table_lookup(config->text_cache, key);
+    if (layout) {
+        g_free(key);
+        // Offscreen charts may render to several targets with different font options
+        if (!config->drawing_area) pango_cairo_update_layout(cr, layout);
+        return layout;
+    }
     
-    // Create drawing area
-    config->drawing_area = gtk_drawing_area_new();
-    gtk_widget_set_size_request(config->drawing_area, 600, 300);
-    gtk_widget_add_events(config->drawing_area, 
-                         GDK_POINTER_MOTION_MASK | 
-                         GDK_BUTTON_PRESS_MASK | 
-                         GDK_BUTTON_RELEASE_MASK |
-                         GDK_SCROLL_MASK);
+    // Labels can be unbounded (axis values), so the cache is flushed rather than grown forever
+    if (g_hash_table_size(config->text_cache) >= CHART_TEXT_CACHE_MAX) {
+        g_hash_table_remove_all(config->text_cache);
+    }
+    
+    if (config->drawing_area) {
+        layout = gtk_widget_create_pango_layout(config->drawing_area, text);
+    } else {
+        layout = pango_cairo_create_layout(cr);
+        pango_layout_set_text(layout, text, -1);
+    }
+    
+    if (font) {
+        PangoFontDescription *desc = pango_font_description_from_string(font);
+        pango_layout_set_font_description(layout, desc);
+        pango_font_description_free(desc);
+    }
+    
+    g_hash_table_insert(config->text_cache, key, layout);
+    config->text_stats.created_total++;
+    config->text_stats.created_last_frame++;
+    return layout;
+}
+
+// Font or theme change: cached text and layers no longer match the widget style
+static void chart_style_updated_cb(GtkWidget *widget, gpointer user_data) {
+    ChartConfig *config = (ChartConfig *)user_data;
+    
+    g_hash_table_remove_all(config->text_cache);
+    chart_invalidate_layers(config);
+    chart_redraw(config);
+}
+
+// Get the text layout cache counters
+void chart_get_text_stats(const ChartConfig *config, ChartTextStats *stats) {
+    *stats = config->text_stats;
+    stats->cached = g_hash_table_size(config->text_cache);
+}
+
+// Create a chart configuration without a widget; it can only be rendered
+// through chart_render() or the export functions, and needs no display
+ChartConfig* chart_config_new_offscreen(const char *title) {
+    ChartConfig *config = g_new0(ChartConfig, 1);
     
     // Set default colors
     gdk_rgba_parse(&config->bg_color, "#1E1E2E");
     gdk_rgba_parse(&config->grid_color, "#45475A");
     gdk_rgba_parse(&config->text_color, "#CDD6F4");
     
-    // Initialize series list
-    config->series = NULL;
+    // Initialize series array
+    config->series = g_ptr_array_new();
+    config->marker_scratch = g_array_new(FALSE, FALSE, sizeof(ChartDataPoint));
+    config->text_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+    config->candles = g_array_new(FALSE, FALSE, sizeof(CandleData));
+    config->type = CHART_TYPE_LINE;
+    config->auto_scale = TRUE;
+    config->y_padding = CHART_Y_PADDING;
+    config->autoscale.min_queue.points = g_array_new(FALSE, FALSE, sizeof(ChartDataPoint));
+    config->autoscale.max_queue.points = g_array_new(FALSE, FALSE, sizeof(ChartDataPoint));
     
     // Set default ranges
     config->min_x = 0;
     config->max_x = 1;
     config->min_y = 0;
     config->max_y = 1;
-    config->zoom_level = 1.0;
-    config->pan_offset = 0.0;
     
     // Set title if provided
     if (title) {
         config->title = g_strdup(title);
     }
     
+    // Own time axis until linked with other charts
+    ChartViewport *viewport = chart_viewport_new();
+    chart_link_viewport(config, viewport);
+    chart_viewport_unref(viewport);
+    
+    return config;
+}
+
+// Give an offscreen chart its drawing area. Data added before this call is kept,
+// so a chart can be fed from startup and only get a widget when first shown.
+GtkWidget* chart_attach_widget(ChartConfig *config, GtkWidget *parent) {
+    g_return_val_if_fail(config != NULL, NULL);
+    if (config->drawing_area) return config->drawing_area;
+    
+    // Create drawing area
+    config->drawing_area = gtk_drawing_area_new();
+    gtk_widget_set_size_request(config->drawing_area, 600, 300);
+    gtk_widget_add_events(config->drawing_area, 
+                         GDK_POINTER_MOTION_MASK | 
+                         GDK_BUTTON_PRESS_MASK | 
+                         GDK_BUTTON_RELEASE_MASK |
+                         GDK_SCROLL_MASK |
+                         GDK_LEAVE_NOTIFY_MASK);
+    
     // Connect signals
     g_signal_connect(config->drawing_area, "draw", 
                     G_CALLBACK(chart_draw_cb), config);
@@ -69,79 +234,160 @@ ChartConfig* chart_config_new(GtkWidget *parent, const char *title) {
                     G_CALLBACK(chart_button_release_cb), config);
     g_signal_connect(config->drawing_area, "scroll-event",
                     G_CALLBACK(chart_scroll_cb), config);
+    g_signal_connect(config->drawing_area, "leave-notify-event",
+                    G_CALLBACK(chart_leave_notify_cb), config);
+    g_signal_connect(config->drawing_area, "style-updated",
+                    G_CALLBACK(chart_style_updated_cb), config);
+    
+    // Layouts shaped offscreen do not use the widget font
+    g_hash_table_remove_all(config->text_cache);
+    chart_invalidate_layers(config);
     
     // Add to parent if provided
     if (parent) {
         gtk_container_add(GTK_CONTAINER(parent), config->drawing_area);
     }
     
+    return config->drawing_area;
+}
+
+// Create a new chart configuration
+ChartConfig* chart_config_new(GtkWidget *parent, const char *title) {
+    ChartConfig *config = chart_config_new_offscreen(title);
+    chart_attach_widget(config, parent);
     return config;
 }
 
-// Add a new data point to a chart series
-void chart_add_point(ChartConfig *chart, const char *series_name, time_t timestamp, double value) {
-    if (!chart || !series_name) return;
+// Append one sample to a series
+static void series_append(ChartSeries *series, double x, double y) {
+    if (series->data == NULL) {
+        series->data = g_array_new(FALSE, FALSE, sizeof(ChartDataPoint));
+    }
     
-    // Find the series
-    ChartSeries *series = NULL;
-    GList *iter = chart->series;
-    while (iter) {
-        ChartSeries *s = (ChartSeries *)iter->data;
-        if (s && strcmp(s->label, series_name) == 0) {
-            series = s;
-            break;
-        }
-        iter = g_list_next(iter);
+    ChartDataPoint point = { x, y };
+    g_array_append_val(series->data, point);
+    series->data_revision++;
+}
+
+// Extend the x range to cover every series (data is time-sorted, so only the ends matter)
+static void chart_update_x_range(ChartConfig *config) {
+    double min_x = G_MAXDOUBLE;
+    double max_x = -G_MAXDOUBLE;
+    
+    for (guint i = 0; i < config->series->len; i++) {
+        ChartSeries *series = g_ptr_array_index(config->series, i);
+        if (!series->data || series->data->len == 0) continue;
+        
+        const ChartDataPoint *points = (const ChartDataPoint *)series->data->data;
+        if (points[0].x < min_x) min_x = points[0].x;
+        if (points[series->data->len - 1].x > max_x) max_x = points[series->data->len - 1].x;
     }
     
-    // If series not found, create it
-    if (!series) {
-        GdkRGBA color;
-        get_default_color(g_list_length(chart->series), &color);
-        chart_add_series(chart, series_name, &color, TRUE);
-        series = (ChartSeries *)g_list_last(chart->series)->data;
+    // Candles extend to the end of their interval
+    if (config->type == CHART_TYPE_CANDLE && config->candles->len > 0) {
+        const CandleData *first = &g_array_index(config->candles, CandleData, 0);
+        const CandleData *last = &g_array_index(config->candles, CandleData, config->candles->len - 1);
+        if (first->timestamp < min_x) min_x = first->timestamp;
+        if (last->timestamp + config->candle_interval > max_x) max_x = last->timestamp + config->candle_interval;
     }
     
-    // Add the data point
-    if (series->data == NULL) {
-        series->data = g_array_new(FALSE, FALSE, sizeof(ChartDataPoint));
+    if (min_x > max_x) return;
+    
+    // A fixed-width window slides with the newest sample
+    if (config->time_window > 0) {
+        min_x = max_x - config->time_window;
     }
+    if (max_x <= min_x) max_x = min_x + 1;
     
-    ChartDataPoint point = { (double)timestamp, value };
-    g_array_append_val(series->data, point);
+    config->min_x = min_x;
+    config->max_x = max_x;
+    config->has_x_range = TRUE;
+    
+    chart_viewport_update(config->viewport);
+}
+
+// Append one value per series sharing the same timestamp
+void chart_append_values(ChartConfig *config, time_t timestamp, const ChartSeriesHandle *handles,
+                         const double *values, int count) {
+    if (!config || !values || count <= 0) return;
     
-    // Update chart bounds if needed
-    if (value < chart->min_y) chart->min_y = value * 0.95;
-    if (value > chart->max_y) chart->max_y = value * 1.05;
-    if (chart->min_y == chart->max_y) {
-        chart->min_y *= 0.9;
-        chart->max_y *= 1.1;
+    int appended = 0;
+    for (int i = 0; i < count; i++) {
+        // Without explicit handles, values map to series 0..count-1
+        ChartSeries *series = chart_get_series(config, handles ? handles[i] : i);
+        if (!series) continue;
+        
+        series_append(series, (double)timestamp, values[i]);
+        appended++;
+        
+        // Hidden series do not take part in the y range
+        if (series->visible) {
+            chart_autoscale_push(config, (double)timestamp, values[i]);
+        }
     }
     
-    // Queue redraw
-    if (chart->drawing_area) {
-        gtk_widget_queue_draw(chart->drawing_area);
+    if (appended == 0) return;
+    
+    // Unless pinned, the x range spans the data
+    if (!config->x_range_fixed) {
+        chart_update_x_range(config);
+    }
+    
+    // Mark dirty once for the whole batch
+    chart_redraw(config);
+}
+
+// Add a new data point to a chart series looked up by label
+void chart_add_point(ChartConfig *chart, const char *series_name, time_t timestamp, double value) {
+    if (!chart || !series_name) return;
+    
+    ChartSeriesHandle handle = chart_find_series(chart, series_name);
+    if (handle == CHART_INVALID_SERIES) {
+        g_warning("Chart '%s' has no series named '%s'",
+                  chart->title ? chart->title : "", series_name);
+        return;
     }
+    
+    chart_append_values(chart, timestamp, &handle, &value, 1);
 }
 
 // Clean up chart resources
 void chart_config_free(ChartConfig *config) {
     if (!config) return;
     
+    // Linked charts stop spanning this chart's range
+    chart_viewport_detach(config);
+    
     // Free series data
-    GList *iter = config->series;
-    while (iter) {
-        ChartSeries *series = (ChartSeries *)iter->data;
-        if (series) {
-            g_free(series->label);
-            if (series->data) {
-                g_array_free(series->data, TRUE);
-            }
-            g_free(series);
+    for (guint i = 0; i < config->series->len; i++) {
+        ChartSeries *series = g_ptr_array_index(config->series, i);
+        g_free(series->label);
+        if (series->data) {
+            g_array_free(series->data, TRUE);
+        }
+        if (series->decimation.points) {
+            g_array_free(series->decimation.points, TRUE);
         }
-        iter = g_list_next(iter);
+        g_free(series);
     }
-    g_list_free(config->series);
+    // Drop a pending frame callback
+    if (config->tick_id != 0 && config->drawing_area) {
+        gtk_widget_remove_tick_callback(config->drawing_area, config->tick_id);
+    }
+    
+    g_ptr_array_free(config->series, TRUE);
+    g_array_free(config->marker_scratch, TRUE);
+    g_hash_table_destroy(config->text_cache);
+    if (config->hover.layout) {
+        g_object_unref(config->hover.layout);
+    }
+    g_array_free(config->candles, TRUE);
+    g_array_free(config->autoscale.min_queue.points, TRUE);
+    g_array_free(config->autoscale.max_queue.points, TRUE);
+    
+    // Free cached layers
+    chart_invalidate_layers(config);
+    chart_invalidate_data_layer(config);
     
     // Free title
     g_free(config->title);
@@ -150,10 +396,55 @@ void chart_config_free(ChartConfig *config) {
     g_free(config);
 }
 
-// Add a new series to the chart
-void chart_add_series(ChartConfig *config, const char *label, const GdkRGBA *color, 
-                     gboolean show_points) {
-    if (!config || !label) return;
+// Copy a chart's data, ranges and style into a new offscreen chart. Caches are
+// not copied, so the copy can be rendered on another thread while the original
+// keeps changing on its own.
+ChartConfig* chart_config_copy(const ChartConfig *config) {
+    if (!config) return NULL;
+    
+    ChartConfig *copy = chart_config_new_offscreen(config->title);
+    copy->bg_color = config->bg_color;
+    copy->grid_color = config->grid_color;
+    copy->text_color = config->text_color;
+    copy->min_y = config->min_y;
+    copy->max_y = config->max_y;
+    
+    // The copy pins the visible range, which may come from a shared viewport
+    chart_get_visible_range(config, &copy->min_x, &copy->max_x);
+    copy->has_x_range = TRUE;
+    copy->x_range_fixed = TRUE;
+    chart_viewport_update(copy->viewport);
+    copy->time_window = config->time_window;
+    copy->type = config->type;
+    copy->candle_interval = config->candle_interval;
+    copy->auto_scale = config->auto_scale;
+    copy->log_scale = config->log_scale;
+    copy->y_padding = config->y_padding;
+    g_array_append_vals(copy->candles, config->candles->data, config->candles->len);
+    
+    for (guint i = 0; i < config->series->len; i++) {
+        const ChartSeries *series = g_ptr_array_index(config->series, i);
+        
+        ChartSeries *dup = g_new0(ChartSeries, 1);
+        dup->label = g_strdup(series->label);
+        dup->color = series->color;
+        dup->show_points = series->show_points;
+        dup->visible = series->visible;
+        dup->data = g_array_sized_new(FALSE, FALSE, sizeof(ChartDataPoint),
+                                      series->data ? series->data->len : 0);
+        if (series->data) {
+            g_array_append_vals(dup->data, series->data->data, series->data->len);
+        }
+        g_ptr_array_add(copy->series, dup);
+    }
+    
+    return copy;
+}
+
+// Add a new series to the chart and return its handle
+ChartSeriesHandle chart_add_series(ChartConfig *config, const char *label, const GdkRGBA *color, 
+                                   gboolean show_points) {
+    if (!config || !label) return CHART_INVALID_SERIES;
     
     // Create new series
     ChartSeries *series = g_new0(ChartSeries, 1);
@@ -163,297 +454,1575 @@ void chart_add_series(ChartConfig *config, const char *label, const GdkRGBA *col
     } else {
         // Default color if none provided
         GdkRGBA default_color = {0.0, 0.0, 1.0, 1.0}; // Blue
-        get_default_color(g_list_length(config->series), &default_color);
+        get_default_color(config->series->len, &default_color);
         series->color = default_color;
     }
     series->show_points = show_points;
     series->visible = TRUE;
     series->data = g_array_new(FALSE, FALSE, sizeof(ChartDataPoint));
     
-    // Add to series list
-    config->series = g_list_append(config->series, series);
+    // Handles are indices, so they stay valid for the chart's lifetime
+    ChartSeriesHandle handle = (ChartSeriesHandle)config->series->len;
+    g_ptr_array_add(config->series, series);
+    
+    // The legend gains an entry
+    chart_invalidate_layers(config);
     
     // Queue redraw
-    if (config->drawing_area) {
-        gtk_widget_queue_draw(config->drawing_area);
+    chart_redraw(config);
+    
+    return handle;
+}
+
+// Get a series by handle
+ChartSeries* chart_get_series(ChartConfig *config, ChartSeriesHandle handle) {
+    if (!config || handle < 0 || (guint)handle >= config->series->len) return NULL;
+    return g_ptr_array_index(config->series, handle);
+}
+
+// Look up a series handle by label (meant for setup, not per-sample use)
+ChartSeriesHandle chart_find_series(ChartConfig *config, const char *label) {
+    if (!config || !label) return CHART_INVALID_SERIES;
+    
+    for (guint i = 0; i < config->series->len; i++) {
+        ChartSeries *series = g_ptr_array_index(config->series, i);
+        if (strcmp(series->label, label) == 0) {
+            return (ChartSeriesHandle)i;
+        }
     }
+    return CHART_INVALID_SERIES;
 }
 
 // Add a data point to a series
-void chart_add_data(ChartConfig *config, int series_index, double value) {
+void chart_add_data(ChartConfig *config, ChartSeriesHandle handle, double value) {
     if (!config) return;
     
-    // Get the series
-    GList *item = g_list_nth(config->series, series_index);
-    if (!item) return;
-    
-    ChartSeries *series = (ChartSeries *)item->data;
-    if (!series) return;
-    
     // Add data point with current time
     time_t now = time(NULL);
-    chart_add_point(config, series->label, now, value);
+    chart_append_values(config, now, &handle, &value, 1);
 }
 
 // Clear a data series
-void chart_clear_series(ChartConfig *config, int series_index) {
-    if (!config) return;
-    
-    // Get the series
-    GList *item = g_list_nth(config->series, series_index);
-    if (!item) return;
-    
-    ChartSeries *series = (ChartSeries *)item->data;
+void chart_clear_series(ChartConfig *config, ChartSeriesHandle handle) {
+    ChartSeries *series = chart_get_series(config, handle);
     if (!series) return;
     
     // Clear data
     if (series->data) {
         g_array_remove_range(series->data, 0, series->data->len);
     }
+    series->data_revision++;
+    chart_autoscale_invalidate(config);
     
     // Queue redraw
-    if (config->drawing_area) {
-        gtk_widget_queue_draw(config->drawing_area);
-    }
+    chart_redraw(config);
 }
 
-// Set the time range for the chart
-void chart_set_time_range(ChartConfig *config, int64_t start, int64_t end) {
-    if (!config) return;
+// Start an aggregator with the given candle interval (seconds)
+void candle_aggregator_init(CandleAggregator *agg, int64_t interval) {
+    memset(agg, 0, sizeof(*agg));
+    agg->interval = interval > 0 ? interval : 0;
+}
+
+// Add a sample to the current bucket. Returns TRUE when the sample starts a new
+// bucket, in which case the finished candle is copied to `closed`.
+gboolean candle_aggregator_push(CandleAggregator *agg, time_t timestamp, double value, CandleData *closed) {
+    if (!agg || agg->interval <= 0) return FALSE;
     
-    config->min_x = start;
-    config->max_x = end;
+    time_t bucket = timestamp - (timestamp % agg->interval);
+    CandleData *c = &agg->current;
     
-    // Queue redraw
-    if (config->drawing_area) {
-        gtk_widget_queue_draw(config->drawing_area);
+    if (agg->has_current) {
+        if (bucket == c->timestamp) {
+            if (value > c->high) c->high = value;
+            if (value < c->low) c->low = value;
+            c->close = value;
+            return FALSE;
+        }
+        
+        // Late samples from an already closed bucket are dropped
+        if (bucket < c->timestamp) return FALSE;
+        
+        if (closed) *closed = *c;
     }
+    
+    gboolean finished = agg->has_current;
+    c->timestamp = bucket;
+    c->open = c->high = c->low = c->close = value;
+    agg->has_current = TRUE;
+    return finished;
 }
 
-// Draw grid lines
-void chart_draw_grid(ChartConfig *config, cairo_t *cr, int width, int height) {
-    if (!config || !cr) return;
-    
-    // Draw background
-    gdk_cairo_set_source_rgba(cr, &config->bg_color);
-    cairo_paint(cr);
+// Copy the candle still being filled
+gboolean candle_aggregator_current(const CandleAggregator *agg, CandleData *current) {
+    if (!agg || !agg->has_current) return FALSE;
+    *current = agg->current;
+    return TRUE;
+}
+
+// Set how series are rendered
+void chart_set_type(ChartConfig *config, ChartType type) {
+    if (!config || config->type == type) return;
     
-    // Set grid style
-    cairo_set_line_width(cr, 0.5);
-    gdk_cairo_set_source_rgba(cr, &config->grid_color);
+    config->type = type;
+    chart_autoscale_invalidate(config);
+    if (!config->x_range_fixed) {
+        chart_update_x_range(config);
+    }
+    chart_invalidate_data_layer(config);
+    chart_redraw(config);
+}
+
+// Add or update candles. A candle with the same timestamp as the last stored one
+// replaces it (the in-progress bucket); older candles are ignored.
+void chart_add_candle_data(ChartConfig *config, const CandleData *candles, int count) {
+    if (!config || !candles || count <= 0) return;
     
-    // Draw vertical grid lines (time axis)
-    int num_x_ticks = 5;
-    for (int i = 0; i <= num_x_ticks; i++) {
-        double x = (width * i) / num_x_ticks;
-        cairo_move_to(cr, x, 0);
-        cairo_line_to(cr, x, height);
-        cairo_stroke(cr);
+    for (int i = 0; i < count; i++) {
+        const CandleData *c = &candles[i];
+        guint len = config->candles->len;
+        CandleData *last = len > 0 ? &g_array_index(config->candles, CandleData, len - 1) : NULL;
+        
+        if (last && c->timestamp == last->timestamp) {
+            *last = *c;
+        } else if (!last || c->timestamp > last->timestamp) {
+            g_array_append_val(config->candles, *c);
+        }
     }
+    config->autoscale.revision++;
     
-    // Draw horizontal grid lines (value axis)
-    int num_y_ticks = 5;
-    for (int i = 0; i <= num_y_ticks; i++) {
-        double y = (height * i) / num_y_ticks;
-        cairo_move_to(cr, 0, y);
-        cairo_line_to(cr, width, y);
-        cairo_stroke(cr);
+    if (config->type != CHART_TYPE_CANDLE) return;
+    
+    if (!config->x_range_fixed) {
+        chart_update_x_range(config);
     }
+    chart_redraw(config);
 }
 
-// Draw a single data series
-void chart_draw_series(ChartConfig *config, cairo_t *cr, int width, int height) {
-    if (!config || !config->series) return;
+// Remove all candles
+void chart_clear_candles(ChartConfig *config) {
+    if (!config) return;
     
-    GList *iter = config->series;
-    while (iter) {
-        ChartSeries *series = (ChartSeries *)iter->data;
-        if (series && series->visible && series->data && series->data->len > 0) {
-            // Set line style
-            gdk_cairo_set_source_rgba(cr, &series->color);
-            cairo_set_line_width(cr, 2.0);
-            
-            // Draw the line
-            gboolean first = TRUE;
-            for (guint i = 0; i < series->data->len; i++) {
-                ChartDataPoint *point = &g_array_index(series->data, ChartDataPoint, i);
-                double x = (point->x - config->min_x) * width / (config->max_x - config->min_x);
-                double y = height - (point->y - config->min_y) * height / (config->max_y - config->min_y);
-                
-                if (first) {
-                    cairo_move_to(cr, x, y);
-                    first = FALSE;
-                } else {
-                    cairo_line_to(cr, x, y);
-                }
-            }
-            cairo_stroke(cr);
-            
-            // Draw points if enabled
-            if (series->show_points) {
-                for (guint i = 0; i < series->data->len; i++) {
-                    ChartDataPoint *point = &g_array_index(series->data, ChartDataPoint, i);
-                    double x = (point->x - config->min_x) * width / (config->max_x - config->min_x);
-                    double y = height - (point->y - config->min_y) * height / (config->max_y - config->min_y);
-                    
-                    cairo_arc(cr, x, y, 3.0, 0, 2 * G_PI);
-                    cairo_fill(cr);
-                }
-            }
-            for (guint i = 0; i < series->data->len; i++) {
-                ChartDataPoint *point = &g_array_index(series->data, ChartDataPoint, i);
-                
-                // Map data coordinates to screen coordinates
-                double x = ((point->x - config->min_x) / (config->max_x - config->min_x)) * width;
-                double y = height - ((point->y - config->min_y) / (config->max_y - config->min_y)) * height;
-                
-                if (first) {
-                    cairo_move_to(cr, x, y);
-                    first = FALSE;
-                } else {
-                    cairo_line_to(cr, x, y);
-                }
-                
-                // Draw point if enabled
-                if (series->show_points) {
-                    cairo_arc(cr, x, y, 2.5, 0, 2 * G_PI);
-                    cairo_fill(cr);
-                }
-            }
-            
-            // Stroke the line
-            cairo_stroke(cr);
-        }
-        iter = g_list_next(iter);
+    g_array_set_size(config->candles, 0);
+    config->autoscale.revision++;
+    if (config->type == CHART_TYPE_CANDLE) {
+        chart_redraw(config);
     }
 }
 
-// Draw the chart legend
-void chart_draw_legend(ChartConfig *config, cairo_t *cr, int width, int height) {
-    if (!config || !config->series) return;
+// Rebuild the candles of a series for a new interval and leave the aggregator
+// ready to continue from the last sample
+void chart_rebuild_candles(ChartConfig *config, ChartSeriesHandle handle, int64_t interval,
+                           CandleAggregator *agg) {
+    ChartSeries *series = chart_get_series(config, handle);
+    if (!series || !agg) return;
     
-    const int legend_padding = 10;
-    const int legend_item_height = 20;
-    const int legend_swatch_size = 12;
-    const int legend_text_padding = 5;
+    candle_aggregator_init(agg, interval);
+    config->candle_interval = interval;
+    g_array_set_size(config->candles, 0);
     
-    // Count visible series
-    int visible_count = 0;
-    GList *iter = config->series;
-    while (iter) {
-        ChartSeries *series = (ChartSeries *)iter->data;
-        if (series && series->visible) visible_count++;
-        iter = g_list_next(iter);
+    CandleData closed;
+    for (guint i = 0; i < series->data->len; i++) {
+        const ChartDataPoint *p = &g_array_index(series->data, ChartDataPoint, i);
+        if (candle_aggregator_push(agg, (time_t)p->x, p->y, &closed)) {
+            g_array_append_val(config->candles, closed);
+        }
+    }
+    if (candle_aggregator_current(agg, &closed)) {
+        g_array_append_val(config->candles, closed);
     }
+    config->autoscale.revision++;
     
-    if (visible_count == 0) return;
+    if (!config->x_range_fixed) {
+        chart_update_x_range(config);
+    }
+    chart_invalidate_data_layer(config);
+    chart_redraw(config);
+}
+
+// Show or hide a series
+void chart_set_series_visible(ChartConfig *config, ChartSeriesHandle handle, gboolean visible) {
+    ChartSeries *series = chart_get_series(config, handle);
+    if (!series || series->visible == visible) return;
     
-    // Calculate legend dimensions
-    int legend_width = 150;
-    int legend_height = visible_count * legend_item_height + 2 * legend_padding;
-    int legend_x = width - legend_width - legend_padding;
-    int legend_y = legend_padding;
+    series->visible = visible;
     
-    // Draw legend background
-    GdkRGBA bg = {0.1, 0.1, 0.1, 0.8};
-    gdk_cairo_set_source_rgba(cr, &bg);
-    cairo_rectangle(cr, legend_x, legend_y, legend_width, legend_height);
-    cairo_fill(cr);
+    // The legend lists visible series only, and only they are scaled
+    chart_invalidate_layers(config);
+    chart_autoscale_invalidate(config);
+    chart_invalidate_data_layer(config);
     
-    // Draw legend items
-    int item_y = legend_y + legend_padding;
-    iter = config->series;
-    while (iter) {
-        ChartSeries *series = (ChartSeries *)iter->data;
-        if (series && series->visible) {
-            // Draw color swatch
-            gdk_cairo_set_source_rgba(cr, &series->color);
-            cairo_rectangle(cr, legend_x + legend_padding, item_y, 
-                          legend_swatch_size, legend_swatch_size);
-            cairo_fill(cr);
-            
-            // Draw label
-            gdk_cairo_set_source_rgba(cr, &config->text_color);
-            PangoLayout *layout = gtk_widget_create_pango_layout(config->drawing_area, series->label);
-            cairo_move_to(cr, legend_x + legend_padding + legend_swatch_size + legend_text_padding, 
-                         item_y - 3);
-            pango_cairo_show_layout(cr, layout);
-            g_object_unref(layout);
-            
-            item_y += legend_item_height;
-        }
-        iter = g_list_next(iter);
+    chart_redraw(config);
+}
+
+// Drop the cached static layers; they are rebuilt on the next draw
+void chart_invalidate_layers(ChartConfig *config) {
+    if (!config) return;
+    
+    ChartLayerCache *layers = &config->layers;
+    if (layers->background) {
+        cairo_surface_destroy(layers->background);
+        layers->background = NULL;
+    }
+    if (layers->legend) {
+        cairo_surface_destroy(layers->legend);
+        layers->legend = NULL;
     }
+    layers->valid = FALSE;
 }
 
+// Drop the data layer; the next draw replots it from scratch
+static void chart_invalidate_data_layer(ChartConfig *config) {
+    ChartDataLayer *layer = &config->data_layer;
+    if (layer->surface) {
+        cairo_surface_destroy(layer->surface);
+        layer->surface = NULL;
+    }
+    if (layer->spare) {
+        cairo_surface_destroy(layer->spare);
+        layer->spare = NULL;
+    }
+    layer->valid = FALSE;
+}
 
-// Main drawing callback
-gboolean chart_draw_cb(GtkWidget *widget, cairo_t *cr, gpointer user_data) {
-    ChartConfig *config = (ChartConfig *)user_data;
-    if (!config) return FALSE;
-    
-    GtkAllocation allocation;
-    gtk_widget_get_allocation(widget, &allocation);
-    int width = allocation.width;
-    int height = allocation.height;
+// Show only the newest `seconds` of data while the x range follows the data
+void chart_set_time_window(ChartConfig *config, double seconds) {
+    if (!config) return;
     
-    // Set background color
-    gdk_cairo_set_source_rgba(cr, &config->bg_color);
-    cairo_paint(cr);
+    config->time_window = seconds > 0 ? seconds : 0;
+    chart_autoscale_invalidate(config);
+    if (!config->x_range_fixed) {
+        chart_update_x_range(config);
+    }
     
-    // Draw grid
-    chart_draw_grid(config, cr, width, height);
+    chart_redraw(config);
+}
+
+// Set the time range for the chart
+void chart_set_time_range(ChartConfig *config, int64_t start, int64_t end) {
+    if (!config) return;
     
-    // Draw series
-    chart_draw_series(config, cr, width, height);
+    config->min_x = start;
+    config->max_x = end;
+    config->has_x_range = TRUE;
+    config->x_range_fixed = TRUE;
+    chart_autoscale_invalidate(config);
     
-    // Draw legend
-    chart_draw_legend(config, cr, width, height);
+    chart_viewport_update(config->viewport);
     
-    return FALSE;
+    // Queue redraw
+    chart_redraw(config);
 }
 
-// Mouse motion event handler
-gboolean chart_motion_notify_cb(GtkWidget *widget, GdkEventMotion *event, gpointer user_data) {
-    ChartConfig *config = (ChartConfig*)user_data;
-    if (!config) return FALSE;
+// Create a viewport with no charts
+ChartViewport* chart_viewport_new(void) {
+    ChartViewport *viewport = g_new0(ChartViewport, 1);
+    viewport->min_x = 0;
+    viewport->max_x = 1;
+    viewport->zoom_level = 1.0;
+    viewport->view_end = 1;
+    viewport->charts = g_ptr_array_new();
+    viewport->ref_count = 1;
+    return viewport;
+}
+
+ChartViewport* chart_viewport_ref(ChartViewport *viewport) {
+    if (viewport) viewport->ref_count++;
+    return viewport;
+}
+
+// Each subscribed chart holds a reference, so the last unref happens with no charts left
+void chart_viewport_unref(ChartViewport *viewport) {
+    if (!viewport || --viewport->ref_count > 0) return;
+    
+    g_ptr_array_free(viewport->charts, TRUE);
+    g_free(viewport);
+}
+
+// Keep the pan offset inside the shared range for the current zoom
+static void chart_viewport_clamp_pan(ChartViewport *viewport) {
+    double range = viewport->max_x - viewport->min_x;
+    double max_pan = range * (1.0 - 1.0 / viewport->zoom_level);
+    if (viewport->pan_offset > max_pan) viewport->pan_offset = max_pan;
+    if (viewport->pan_offset < 0) viewport->pan_offset = 0;
+}
+
+// Recompute the shared range and the visible window once; when the window moves
+// every linked chart is marked dirty, so they repaint on the same frame
+static void chart_viewport_update(ChartViewport *viewport) {
+    double min_x = G_MAXDOUBLE;
+    double max_x = -G_MAXDOUBLE;
+    
+    for (guint i = 0; i < viewport->charts->len; i++) {
+        const ChartConfig *chart = g_ptr_array_index(viewport->charts, i);
+        if (!chart->has_x_range) continue;
+        if (chart->min_x < min_x) min_x = chart->min_x;
+        if (chart->max_x > max_x) max_x = chart->max_x;
+    }
+    if (min_x > max_x) {
+        min_x = 0;
+        max_x = 1;
+    }
+    
+    viewport->min_x = min_x;
+    viewport->max_x = max_x;
+    if (viewport->zoom_level < 1.0) viewport->zoom_level = 1.0;
+    chart_viewport_clamp_pan(viewport);
+    
+    double start = min_x + viewport->pan_offset;
+    double end = start + (max_x - min_x) / viewport->zoom_level;
+    if (start == viewport->view_start && end == viewport->view_end) return;
+    
+    viewport->view_start = start;
+    viewport->view_end = end;
+    viewport->revision++;
+    
+    for (guint i = 0; i < viewport->charts->len; i++) {
+        chart_redraw(g_ptr_array_index(viewport->charts, i));
+    }
+}
+
+// Unsubscribe a chart from its viewport
+static void chart_viewport_detach(ChartConfig *config) {
+    ChartViewport *viewport = config->viewport;
+    if (!viewport) return;
+    
+    config->viewport = NULL;
+    g_ptr_array_remove(viewport->charts, config);
+    chart_viewport_update(viewport);
+    chart_viewport_unref(viewport);
+}
+
+// Make a chart follow a viewport, sharing its x range, zoom and pan with the
+// other charts linked to it
+void chart_link_viewport(ChartConfig *config, ChartViewport *viewport) {
+    if (!config || !viewport || config->viewport == viewport) return;
+    
+    chart_viewport_detach(config);
+    config->viewport = chart_viewport_ref(viewport);
+    g_ptr_array_add(viewport->charts, config);
+    
+    // The shared range can start before each chart's own window
+    for (guint i = 0; i < viewport->charts->len; i++) {
+        chart_autoscale_invalidate(g_ptr_array_index(viewport->charts, i));
+    }
+    
+    chart_viewport_update(viewport);
+    chart_redraw(config);
+}
+
+// Reset zoom and pan of every chart on the viewport
+void chart_viewport_reset(ChartViewport *viewport) {
+    if (!viewport) return;
+    
+    viewport->zoom_level = 1.0;
+    viewport->pan_offset = 0.0;
+    chart_viewport_update(viewport);
+}
+
+// Zoom to `zoom_level` keeping `data_x` at `fraction` of the visible width
+void chart_viewport_zoom_at(ChartViewport *viewport, double zoom_level, double data_x, double fraction) {
+    if (!viewport) return;
+    
+    viewport->zoom_level = zoom_level >= 1.0 ? zoom_level : 1.0;
+    double visible_range = (viewport->max_x - viewport->min_x) / viewport->zoom_level;
+    viewport->pan_offset = (data_x - fraction * visible_range) - viewport->min_x;
+    chart_viewport_update(viewport);
+}
+
+// Visible x range after applying zoom and pan
+void chart_get_visible_range(const ChartConfig *config, double *start, double *end) {
+    *start = config->viewport->view_start;
+    *end = config->viewport->view_end;
+}
+
+// Reset zoom and pan to show the whole range
+void chart_reset_zoom(ChartConfig *config) {
+    if (!config) return;
+    
+    chart_viewport_reset(config->viewport);
+}
+
+// Draw a y axis label just above its grid line
+static void chart_draw_y_label(ChartConfig *config, cairo_t *cr, double value, double y) {
+    char text[32];
+    snprintf(text, sizeof(text), "%g", value);
+    
+    PangoLayout *layout = chart_text_layout(config, cr, text, CHART_AXIS_FONT);
+    int text_height;
+    pango_layout_get_pixel_size(layout, NULL, &text_height);
+    
+    cairo_move_to(cr, 4, MAX(0, y - text_height - 1));
+    pango_cairo_show_layout(cr, layout);
+}
+
+// Pin the y range; turns autoscaling off
+void chart_set_y_range(ChartConfig *config, double min_y, double max_y) {
+    if (!config || max_y <= min_y) return;
+    
+    config->auto_scale = FALSE;
+    config->min_y = min_y;
+    config->max_y = max_y;
+    
+    chart_invalidate_layers(config);
+    chart_redraw(config);
+}
+
+// Fit the y range to the visible data, with `padding` as a fraction of the data span
+void chart_set_auto_scale(ChartConfig *config, gboolean auto_scale, double padding) {
+    if (!config) return;
+    
+    config->auto_scale = auto_scale;
+    config->y_padding = padding >= 0 ? padding : CHART_Y_PADDING;
+    
+    chart_redraw(config);
+}
+
+// Switch between a linear and a logarithmic y axis
+void chart_set_log_scale(ChartConfig *config, gboolean log_scale) {
+    if (!config || config->log_scale == log_scale) return;
+    
+    config->log_scale = log_scale;
+    
+    // Every plotted y changes
+    chart_invalidate_layers(config);
+    chart_invalidate_data_layer(config);
+    chart_redraw(config);
+}
+
+// Apply the advanced options the chart supports
+void chart_set_advanced_config(ChartConfig *config, const ChartAdvancedConfig *adv_config) {
+    if (!config || !adv_config) return;
+    
+    chart_set_type(config, adv_config->type);
+    chart_set_log_scale(config, adv_config->log_scale);
+    chart_set_auto_scale(config, adv_config->auto_scale, config->y_padding);
+    chart_set_time_window(config, (double)adv_config->time_window);
+}
+
+// Draw grid lines
+void chart_draw_grid(ChartConfig *config, cairo_t *cr, int width, int height) {
+    if (!config || !cr) return;
+    
+    // Draw background
+    gdk_cairo_set_source_rgba(cr, &config->bg_color);
+    cairo_paint(cr);
+    
+    // Set grid style
+    cairo_set_line_width(cr, 0.5);
+    gdk_cairo_set_source_rgba(cr, &config->grid_color);
+    
+    // Vertical grid lines (time axis)
+    int num_x_ticks = 5;
+    for (int i = 0; i <= num_x_ticks; i++) {
+        double x = (width * i) / num_x_ticks;
+        cairo_move_to(cr, x, 0);
+        cairo_line_to(cr, x, height);
+    }
+    
+    // Horizontal grid lines (value axis) on nice values: multiples of the tick
+    // step, or whole decades on a log scale
+    ChartYMap y_map;
+    chart_y_map_init(&y_map, config, height);
+    
+    double ticks[64];
+    int num_y_ticks = 0;
+    if (config->max_y > config->min_y) {
+        if (config->log_scale) {
+            double decade = pow(10, floor(log10(MAX(config->min_y, CHART_LOG_MIN))));
+            for (double v = decade; v <= config->max_y * (1 + 1e-9) && num_y_ticks < 64; v *= 10) {
+                if (v >= config->min_y * (1 - 1e-9)) ticks[num_y_ticks++] = v;
+            }
+        } else {
+            double step = chart_nice_step((config->max_y - config->min_y) / CHART_Y_TICKS);
+            double first = ceil(config->min_y / step - 1e-9) * step;
+            for (double v = first; v <= config->max_y + step * 1e-9 && num_y_ticks < 64; v += step) {
+                ticks[num_y_ticks++] = fabs(v) < step * 1e-9 ? 0 : v;
+            }
+        }
+    }
+    
+    for (int i = 0; i < num_y_ticks; i++) {
+        double y = round(chart_y_map(&y_map, ticks[i])) + 0.5;
+        cairo_move_to(cr, 0, y);
+        cairo_line_to(cr, width, y);
+    }
     
-    // Handle panning if left button is pressed
-    if (event->state & GDK_BUTTON1_MASK) {
-        static gdouble last_x = 0;
+    // Stroke the whole grid at once
+    cairo_stroke(cr);
+    
+    // Axis labels
+    gdk_cairo_set_source_rgba(cr, &config->text_color);
+    for (int i = 0; i < num_y_ticks; i++) {
+        chart_draw_y_label(config, cr, ticks[i], chart_y_map(&y_map, ticks[i]));
+    }
+}
+
+// Emit the first, min, max and last samples of a column in data order (M4 reduction)
+static void decimation_flush(GArray *out, const ChartDataPoint *points,
+                             guint first, guint min, guint max, guint last) {
+    guint idx[4] = { first, min, max, last };
+    
+    // Sort the four indices (tiny fixed-size insertion sort)
+    for (int i = 1; i < 4; i++) {
+        guint v = idx[i];
+        int j = i - 1;
+        while (j >= 0 && idx[j] > v) {
+            idx[j + 1] = idx[j];
+            j--;
+        }
+        idx[j + 1] = v;
+    }
+    
+    for (int i = 0; i < 4; i++) {
+        if (i > 0 && idx[i] == idx[i - 1]) continue;
+        g_array_append_val(out, points[idx[i]]);
+    }
+}
+
+// Index of the first point with x >= value in a time-sorted series
+static guint series_lower_bound(const ChartDataPoint *points, guint n, double value) {
+    guint lo = 0, hi = n;
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        if (points[mid].x < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Index of the point closest in time to `value` in a non-empty time-sorted series
+static guint series_nearest(const ChartDataPoint *points, guint n, double value) {
+    guint i = series_lower_bound(points, n, value);
+    if (i == n) return n - 1;
+    if (i > 0 && value - points[i - 1].x <= points[i].x - value) return i - 1;
+    return i;
+}
+
+// Index range [first, end) of the points needed to draw [start, stop], keeping
+// one neighbour on each side so lines reach the edges
+static void series_visible_slice(const GArray *data, double start, double stop,
+                                 guint *first, guint *end) {
+    const ChartDataPoint *points = (const ChartDataPoint *)data->data;
+    guint n = data->len;
+    
+    guint lo = series_lower_bound(points, n, start);
+    guint hi = series_lower_bound(points, n, stop);
+    while (hi < n && points[hi].x <= stop) hi++;
+    
+    *first = lo > 0 ? lo - 1 : 0;
+    *end = hi < n ? hi + 1 : n;
+}
+
+// Append a sample to a monotonic queue, dropping the samples it dominates
+static void extrema_queue_push(ChartExtremaQueue *queue, ChartDataPoint point, gboolean keep_max) {
+    guint len = queue->points->len;
+    const ChartDataPoint *points = (const ChartDataPoint *)queue->points->data;
+    
+    while (len > queue->head &&
+           (keep_max ? points[len - 1].y <= point.y : points[len - 1].y >= point.y)) {
+        len--;
+    }
+    g_array_set_size(queue->points, len);
+    g_array_append_val(queue->points, point);
+}
+
+// Drop samples older than `start`, compacting the array once the dead prefix dominates
+static void extrema_queue_evict(ChartExtremaQueue *queue, double start) {
+    const ChartDataPoint *points = (const ChartDataPoint *)queue->points->data;
+    while (queue->head < queue->points->len && points[queue->head].x < start) {
+        queue->head++;
+    }
+    
+    if (queue->head > 64 && queue->head * 2 > queue->points->len) {
+        g_array_remove_range(queue->points, 0, queue->head);
+        queue->head = 0;
+    }
+}
+
+static void extrema_queue_clear(ChartExtremaQueue *queue) {
+    g_array_set_size(queue->points, 0);
+    queue->head = 0;
+}
+
+// Feed an appended visible sample to the sliding-window extremes
+static void chart_autoscale_push(ChartConfig *config, double x, double y) {
+    ChartAutoscale *as = &config->autoscale;
+    
+    as->revision++;
+    if (!as->queues_valid) return;
+    
+    ChartDataPoint point = { x, y };
+    extrema_queue_push(&as->min_queue, point, FALSE);
+    extrema_queue_push(&as->max_queue, point, TRUE);
+}
+
+// Data was removed, hidden or the window grew: rebuild the extremes on next use
+static void chart_autoscale_invalidate(ChartConfig *config) {
+    config->autoscale.queues_valid = FALSE;
+    config->autoscale.revision++;
+}
+
+static int point_compare_x(const void *a, const void *b) {
+    double xa = ((const ChartDataPoint *)a)->x;
+    double xb = ((const ChartDataPoint *)b)->x;
+    return (xa > xb) - (xa < xb);
+}
+
+// Refill the queues from the visible series from `start` on
+static void chart_autoscale_rebuild(ChartConfig *config, double start) {
+    ChartAutoscale *as = &config->autoscale;
+    extrema_queue_clear(&as->min_queue);
+    extrema_queue_clear(&as->max_queue);
+    
+    // Samples of all series merged in time order, as they would have been appended
+    GArray *merged = g_array_new(FALSE, FALSE, sizeof(ChartDataPoint));
+    for (guint s = 0; s < config->series->len; s++) {
+        ChartSeries *series = g_ptr_array_index(config->series, s);
+        if (!series->visible || !series->data || series->data->len == 0) continue;
         
-        if (last_x > 0) {
-            double dx = event->x - last_x;
-            double range = config->max_x - config->min_x;
-            double visible_range = range / config->zoom_level;
+        const ChartDataPoint *points = (const ChartDataPoint *)series->data->data;
+        guint first = series_lower_bound(points, series->data->len, start);
+        g_array_append_vals(merged, points + first, series->data->len - first);
+    }
+    if (config->series->len > 1) {
+        qsort(merged->data, merged->len, sizeof(ChartDataPoint), point_compare_x);
+    }
+    
+    for (guint i = 0; i < merged->len; i++) {
+        ChartDataPoint point = g_array_index(merged, ChartDataPoint, i);
+        extrema_queue_push(&as->min_queue, point, FALSE);
+        extrema_queue_push(&as->max_queue, point, TRUE);
+    }
+    g_array_free(merged, TRUE);
+    
+    as->queue_start = start;
+    as->queues_valid = TRUE;
+}
+
+// Scan the visible slice of every series (or the visible candles) once
+static gboolean chart_scan_extremes(ChartConfig *config, double view_start, double view_end,
+                                    double *min, double *max) {
+    double lo = G_MAXDOUBLE, hi = -G_MAXDOUBLE;
+    
+    if (config->type == CHART_TYPE_CANDLE) {
+        for (guint i = 0; i < config->candles->len; i++) {
+            const CandleData *c = &g_array_index(config->candles, CandleData, i);
+            if (c->timestamp + config->candle_interval < view_start || c->timestamp > view_end) continue;
+            if (c->low < lo) lo = c->low;
+            if (c->high > hi) hi = c->high;
+        }
+    } else {
+        for (guint s = 0; s < config->series->len; s++) {
+            ChartSeries *series = g_ptr_array_index(config->series, s);
+            if (!series->visible || !series->data || series->data->len == 0) continue;
             
-            // Update pan offset
-            config->pan_offset += dx * (visible_range / gtk_widget_get_allocated_width(widget));
+            const ChartDataPoint *points = (const ChartDataPoint *)series->data->data;
+            guint n = series->data->len;
+            for (guint i = series_lower_bound(points, n, view_start); i < n && points[i].x <= view_end; i++) {
+                if (points[i].y < lo) lo = points[i].y;
+                if (points[i].y > hi) hi = points[i].y;
+            }
+        }
+    }
+    
+    *min = lo;
+    *max = hi;
+    return lo <= hi;
+}
+
+// Extremes of the visible data. While the view follows the data window they come
+// from the monotonic queues in amortized O(1); zoomed, pinned or candle views are
+// scanned once per data revision or view change.
+static gboolean chart_visible_extremes(ChartConfig *config, double view_start, double view_end) {
+    ChartAutoscale *as = &config->autoscale;
+    
+    gboolean follows_data = config->type != CHART_TYPE_CANDLE && !config->x_range_fixed &&
+                            config->viewport->zoom_level <= 1.0 && config->viewport->pan_offset == 0.0;
+    if (follows_data) {
+        // The queues only evict from the front: a window that moved back in time
+        // (older samples loaded, viewport jumped) needs samples they already dropped
+        if (!as->queues_valid || view_start < as->queue_start) {
+            chart_autoscale_rebuild(config, view_start);
+        }
+        
+        extrema_queue_evict(&as->min_queue, view_start);
+        extrema_queue_evict(&as->max_queue, view_start);
+        as->queue_start = view_start;
+        as->has_data = as->min_queue.head < as->min_queue.points->len;
+        if (as->has_data) {
+            as->data_min = g_array_index(as->min_queue.points, ChartDataPoint, as->min_queue.head).y;
+            as->data_max = g_array_index(as->max_queue.points, ChartDataPoint, as->max_queue.head).y;
+        }
+        return as->has_data;
+    }
+    
+    if (!as->scanned_valid || as->scanned_revision != as->revision ||
+        as->scanned_start != view_start || as->scanned_end != view_end) {
+        as->has_data = chart_scan_extremes(config, view_start, view_end, &as->data_min, &as->data_max);
+        as->scanned_revision = as->revision;
+        as->scanned_start = view_start;
+        as->scanned_end = view_end;
+        as->scanned_valid = TRUE;
+    }
+    return as->has_data;
+}
+
+// Round a raw tick step to 1, 2 or 5 times a power of ten
+double chart_nice_step(double raw_step) {
+    if (!(raw_step > 0) || !isfinite(raw_step)) return 1.0;
+    
+    double magnitude = pow(10, floor(log10(raw_step)));
+    double fraction = raw_step / magnitude;
+    double nice = fraction <= 1 ? 1 : fraction <= 2 ? 2 : fraction <= 5 ? 5 : 10;
+    return nice * magnitude;
+}
+
+// Fit the y range to the visible data, padded and rounded to nice ticks (or whole
+// decades on a log scale). The range only changes when the extremes cross a tick.
+static void chart_autoscale(ChartConfig *config) {
+    if (!config->auto_scale) return;
+    
+    double view_start, view_end;
+    chart_get_visible_range(config, &view_start, &view_end);
+    if (!chart_visible_extremes(config, view_start, view_end)) return;
+    
+    double lo = config->autoscale.data_min;
+    double hi = config->autoscale.data_max;
+    double min_y, max_y;
+    
+    if (config->log_scale) {
+        min_y = pow(10, floor(log10(MAX(lo, CHART_LOG_MIN))));
+        max_y = pow(10, ceil(log10(MAX(hi, CHART_LOG_MIN))));
+        if (max_y <= min_y) max_y = min_y * 10;
+    } else {
+        double span = hi - lo;
+        if (span <= 0) span = fabs(hi) > 0 ? fabs(hi) * 0.1 : 1.0;
+        
+        double step = chart_nice_step((span * (1 + 2 * config->y_padding)) / CHART_Y_TICKS);
+        min_y = floor((lo - span * config->y_padding) / step) * step;
+        max_y = ceil((hi + span * config->y_padding) / step) * step;
+        
+        // Padding never pushes non-negative data (fees, prices) below zero
+        if (lo >= 0 && min_y < 0) min_y = 0;
+    }
+    
+    if (min_y != config->min_y || max_y != config->max_y) {
+        config->min_y = min_y;
+        config->max_y = max_y;
+        
+        // Grid lines and labels live in the background layer
+        chart_invalidate_layers(config);
+    }
+}
+
+// Get the points to draw for the visible slice of a series, reduced to a few per
+// pixel column. The result is cached until the data, visible range or width changes.
+static const ChartDataPoint* chart_series_decimate(ChartSeries *series, double view_start, double view_end,
+                                                   int width, guint *count) {
+    guint slice_first, slice_end;
+    series_visible_slice(series->data, view_start, view_end, &slice_first, &slice_end);
+    
+    const ChartDataPoint *slice = (const ChartDataPoint *)series->data->data + slice_first;
+    guint n = slice_end - slice_first;
+    if (width <= 0 || n <= (guint)width * CHART_DECIMATION_POINTS_PER_COLUMN) {
+        *count = n;
+        return slice;
+    }
+    
+    ChartDecimation *cache = &series->decimation;
+    if (cache->valid && cache->revision == series->data_revision &&
+        cache->min_x == view_start && cache->max_x == view_end && cache->width == width) {
+        *count = cache->points->len;
+        return (const ChartDataPoint *)cache->points->data;
+    }
+    
+    if (!cache->points) {
+        cache->points = g_array_sized_new(FALSE, FALSE, sizeof(ChartDataPoint),
+                                          width * CHART_DECIMATION_POINTS_PER_COLUMN);
+    }
+    g_array_set_size(cache->points, 0);
+    
+    const ChartDataPoint *points = slice;
+    double scale_x = width / (view_end - view_start);
+    
+    // Off-screen samples collapse into one column on each side so edge lines stay correct
+    long column = LONG_MIN;
+    guint first = 0, last = 0, min = 0, max = 0;
+    for (guint i = 0; i < n; i++) {
+        long c = (long)floor((points[i].x - view_start) * scale_x);
+        if (c < -1) c = -1;
+        if (c > width) c = width;
+        
+        if (c != column) {
+            if (column != LONG_MIN) {
+                decimation_flush(cache->points, points, first, min, max, last);
+            }
+            column = c;
+            first = last = min = max = i;
+            continue;
+        }
+        
+        last = i;
+        if (points[i].y < points[min].y) min = i;
+        if (points[i].y > points[max].y) max = i;
+    }
+    decimation_flush(cache->points, points, first, min, max, last);
+    
+    cache->revision = series->data_revision;
+    cache->min_x = view_start;
+    cache->max_x = view_end;
+    cache->width = width;
+    cache->valid = TRUE;
+    *count = cache->points->len;
+    return (const ChartDataPoint *)cache->points->data;
+}
+
+// Fill all collected markers as one path, so the series pays a single fill
+// for its markers instead of one source setup and composite per point
+static void chart_fill_markers(cairo_t *cr, const GArray *positions) {
+    cairo_new_path(cr);
+    for (guint i = 0; i < positions->len; i++) {
+        const ChartDataPoint *p = &g_array_index(positions, ChartDataPoint, i);
+        cairo_new_sub_path(cr);
+        cairo_arc(cr, p->x, p->y, CHART_MARKER_RADIUS, 0, 2 * G_PI);
+    }
+    cairo_fill(cr);
+}
+
+// Whether the visible slice of a series is sparse enough to show markers
+static gboolean series_markers_fit(ChartSeries *series, double view_start, double view_end, double scale_x) {
+    if (!series->show_points) return FALSE;
+    
+    guint first, end;
+    series_visible_slice(series->data, view_start, view_end, &first, &end);
+    if (end - first <= 1) return TRUE;
+    
+    const ChartDataPoint *points = (const ChartDataPoint *)series->data->data;
+    double span = (points[end - 1].x - points[first].x) * scale_x;
+    return fabs(span) / (end - first - 1) >= CHART_MARKER_MIN_SPACING;
+}
+
+// Plot one series over [view_start, view_end]. With from_x >= 0 only the part
+// right of that screen x is plotted, from raw points, for incremental updates.
+static void chart_plot_series(ChartConfig *config, ChartSeries *series, cairo_t *cr, int width, int height,
+                              double view_start, double view_end, double from_x) {
+    double scale_x = width / (view_end - view_start);
+    ChartYMap y_map;
+    chart_y_map_init(&y_map, config, height);
+    
+    guint n;
+    const ChartDataPoint *points;
+    if (from_x >= 0) {
+        guint first, end;
+        series_visible_slice(series->data, view_start + from_x / scale_x, view_end, &first, &end);
+        points = (const ChartDataPoint *)series->data->data + first;
+        n = end - first;
+    } else {
+        // Path size follows what is on screen, not the history length
+        points = chart_series_decimate(series, view_start, view_end, width, &n);
+    }
+    if (n == 0) return;
+    
+    // Markers only make sense while points are spread out on screen
+    gboolean markers = series_markers_fit(series, view_start, view_end, scale_x);
+    g_array_set_size(config->marker_scratch, 0);
+    
+    // Build the path in a single pass, collecting marker positions as we go
+    cairo_new_path(cr);
+    for (guint i = 0; i < n; i++) {
+        double x = (points[i].x - view_start) * scale_x;
+        double y = chart_y_map(&y_map, points[i].y);
+        
+        if (i == 0) {
+            cairo_move_to(cr, x, y);
+        } else {
+            cairo_line_to(cr, x, y);
+        }
+        
+        if (markers) {
+            ChartDataPoint position = { x, y };
+            g_array_append_val(config->marker_scratch, position);
+        }
+    }
+    
+    gdk_cairo_set_source_rgba(cr, &series->color);
+    cairo_stroke(cr);
+    
+    if (markers) {
+        chart_fill_markers(cr, config->marker_scratch);
+    }
+}
+
+// Index of the first candle whose interval ends after `value`
+static guint candle_lower_bound(const CandleData *candles, guint n, double value, int64_t interval) {
+    guint lo = 0, hi = n;
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        if (candles[mid].timestamp + interval < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Add the wicks or bodies of the visible candles going one direction to the path
+static void chart_candle_path(cairo_t *cr, const CandleData *candles, guint first, guint end, gboolean up,
+                              gboolean bodies, double view_start, double scale_x, const ChartYMap *y_map,
+                              double body_width, int64_t interval) {
+    for (guint i = first; i < end; i++) {
+        const CandleData *c = &candles[i];
+        if ((c->close >= c->open) != up) continue;
+        
+        double cx = (c->timestamp + interval / 2.0 - view_start) * scale_x;
+        if (bodies) {
+            double top = chart_y_map(y_map, MAX(c->open, c->close));
+            double bottom = chart_y_map(y_map, MIN(c->open, c->close));
+            cairo_rectangle(cr, cx - body_width / 2, top, body_width, MAX(bottom - top, 1.0));
+        } else {
+            double x = floor(cx) + 0.5;  // Crisp 1px wicks
+            cairo_move_to(cr, x, chart_y_map(y_map, c->high));
+            cairo_line_to(cr, x, chart_y_map(y_map, c->low));
+        }
+    }
+}
+
+// Draw the visible candles with one stroke for the wicks and one fill for the
+// bodies of each direction
+static void chart_draw_candles(ChartConfig *config, cairo_t *cr, int width, int height,
+                               double view_start, double view_end) {
+    guint n = config->candles->len;
+    if (n == 0 || config->candle_interval <= 0) return;
+    
+    const CandleData *candles = (const CandleData *)config->candles->data;
+    double scale_x = width / (view_end - view_start);
+    ChartYMap y_map;
+    chart_y_map_init(&y_map, config, height);
+    double body_width = MAX(1.0, config->candle_interval * scale_x * CANDLE_BODY_RATIO);
+    
+    guint first = candle_lower_bound(candles, n, view_start, config->candle_interval);
+    guint end = candle_lower_bound(candles, n, view_end, 0);
+    while (end < n && candles[end].timestamp <= view_end) end++;
+    if (first >= end) return;
+    
+    cairo_set_line_width(cr, 1.0);
+    for (int up = 1; up >= 0; up--) {
+        gdk_cairo_set_source_rgba(cr, up ? &CANDLE_UP_COLOR : &CANDLE_DOWN_COLOR);
+        
+        cairo_new_path(cr);
+        chart_candle_path(cr, candles, first, end, up, FALSE, view_start, scale_x, &y_map,
+                          body_width, config->candle_interval);
+        cairo_stroke(cr);
+        
+        chart_candle_path(cr, candles, first, end, up, TRUE, view_start, scale_x, &y_map,
+                          body_width, config->candle_interval);
+        cairo_fill(cr);
+    }
+}
+
+// Draw every visible series: one path per series, markers filled as one path
+void chart_draw_series(ChartConfig *config, cairo_t *cr, int width, int height) {
+    if (!config || !config->series) return;
+    
+    // Only the zoomed and panned window is mapped to the widget
+    double view_start, view_end;
+    chart_get_visible_range(config, &view_start, &view_end);
+    if (view_end <= view_start || config->max_y <= config->min_y) return;
+    
+    if (config->type == CHART_TYPE_CANDLE) {
+        chart_draw_candles(config, cr, width, height, view_start, view_end);
+        return;
+    }
+    
+    cairo_set_line_width(cr, 2.0);
+    cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
+    
+    for (guint s = 0; s < config->series->len; s++) {
+        ChartSeries *series = g_ptr_array_index(config->series, s);
+        if (!series->visible || !series->data || series->data->len == 0) continue;
+        
+        chart_plot_series(config, series, cr, width, height, view_start, view_end, -1);
+    }
+}
+
+// Remember how much of each series the data layer holds
+static void chart_mark_plotted(ChartConfig *config) {
+    for (guint s = 0; s < config->series->len; s++) {
+        ChartSeries *series = g_ptr_array_index(config->series, s);
+        series->plotted_count = series->data ? series->data->len : 0;
+        series->plotted_revision = series->data_revision;
+    }
+}
+
+// Device scale of a drawing target (the widget scale factor for window targets)
+static int chart_target_scale(cairo_t *target_cr) {
+    double scale_x, scale_y;
+    cairo_surface_get_device_scale(cairo_get_target(target_cr), &scale_x, &scale_y);
+    return (int)ceil(scale_x);
+}
+
+// Replot the whole data layer
+static gboolean chart_repaint_data_layer(ChartConfig *config, cairo_t *target_cr, int width, int height,
+                                         double view_start, double view_end) {
+    ChartDataLayer *layer = &config->data_layer;
+    int scale = chart_target_scale(target_cr);
+    
+    if (!layer->surface || layer->width != width || layer->height != height || layer->scale != scale) {
+        chart_invalidate_data_layer(config);
+        if (width <= 0 || height <= 0) return FALSE;
+        
+        cairo_surface_t *target = cairo_get_target(target_cr);
+        layer->surface = cairo_surface_create_similar(target, CAIRO_CONTENT_COLOR_ALPHA, width, height);
+        layer->spare = cairo_surface_create_similar(target, CAIRO_CONTENT_COLOR_ALPHA, width, height);
+    }
+    
+    cairo_t *cr = cairo_create(layer->surface);
+    cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+    chart_draw_series(config, cr, width, height);
+    cairo_destroy(cr);
+    
+    layer->view_start = view_start;
+    layer->view_end = view_end;
+    layer->min_y = config->min_y;
+    layer->max_y = config->max_y;
+    layer->width = width;
+    layer->height = height;
+    layer->scale = scale;
+    layer->valid = TRUE;
+    chart_mark_plotted(config);
+    return TRUE;
+}
+
+// Bring the data layer up to date: scroll it when the window slides and plot only
+// the new strip. Rescaling, zooming, panning back, resizing or replaced data force
+// a full replot.
+static gboolean chart_update_data_layer(ChartConfig *config, cairo_t *target_cr, int width, int height) {
+    ChartDataLayer *layer = &config->data_layer;
+    
+    double view_start, view_end;
+    chart_get_visible_range(config, &view_start, &view_end);
+    double range = view_end - view_start;
+    if (range <= 0 || config->max_y <= config->min_y) return FALSE;
+    
+    gboolean reusable = layer->valid && layer->surface &&
+                        layer->width == width && layer->height == height &&
+                        layer->scale == chart_target_scale(target_cr) &&
+                        layer->min_y == config->min_y && layer->max_y == config->max_y &&
+                        fabs((layer->view_end - layer->view_start) - range) <= range * 1e-9 &&
+                        view_start >= layer->view_start;
+    
+    // Only appended data can be plotted incrementally
+    for (guint s = 0; reusable && s < config->series->len; s++) {
+        ChartSeries *series = g_ptr_array_index(config->series, s);
+        guint len = series->data ? series->data->len : 0;
+        if (len < series->plotted_count ||
+            series->data_revision - series->plotted_revision != len - series->plotted_count) {
+            reusable = FALSE;
+        }
+    }
+    
+    // Candles update in place (the open bucket), so they are always replotted
+    if (config->type == CHART_TYPE_CANDLE) reusable = FALSE;
+    
+    double scale_x = width / range;
+    int shift = reusable ? (int)floor((view_start - layer->view_start) * scale_x) : 0;
+    if (!reusable || shift >= width) {
+        return chart_repaint_data_layer(config, target_cr, width, height, view_start, view_end);
+    }
+    
+    // Scroll by whole pixels; the sub-pixel remainder is carried in view_start
+    double dirty_x = width;
+    if (shift > 0) {
+        cairo_t *cr = cairo_create(layer->spare);
+        cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+        cairo_set_source_surface(cr, layer->surface, -shift, 0);
+        cairo_paint(cr);
+        cairo_destroy(cr);
+        
+        cairo_surface_t *tmp = layer->surface;
+        layer->surface = layer->spare;
+        layer->spare = tmp;
+        
+        layer->view_start += shift / scale_x;
+        layer->view_end = layer->view_start + range;
+        dirty_x = width - shift;
+    }
+    
+    // New points dirty the layer from the last point already plotted
+    for (guint s = 0; s < config->series->len; s++) {
+        ChartSeries *series = g_ptr_array_index(config->series, s);
+        if (!series->visible || !series->data || series->data->len == series->plotted_count) continue;
+        
+        guint from = series->plotted_count > 0 ? series->plotted_count - 1 : 0;
+        double x = (g_array_index(series->data, ChartDataPoint, from).x - layer->view_start) * scale_x;
+        if (x < dirty_x) dirty_x = x;
+    }
+    
+    if (dirty_x < width) {
+        dirty_x = floor(MAX(0, dirty_x - CHART_DIRTY_PAD));
+        
+        cairo_t *cr = cairo_create(layer->surface);
+        cairo_rectangle(cr, dirty_x, 0, width - dirty_x, height);
+        cairo_clip(cr);
+        cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+        cairo_paint(cr);
+        cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+        
+        cairo_set_line_width(cr, 2.0);
+        cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
+        for (guint s = 0; s < config->series->len; s++) {
+            ChartSeries *series = g_ptr_array_index(config->series, s);
+            if (!series->visible || !series->data || series->data->len == 0) continue;
             
-            // Clamp pan offset to valid range
-            double max_pan = range * (1.0 - 1.0/config->zoom_level);
-            if (config->pan_offset > max_pan) config->pan_offset = max_pan;
-            if (config->pan_offset < 0) config->pan_offset = 0;
+            chart_plot_series(config, series, cr, width, height,
+                              layer->view_start, layer->view_end, dirty_x);
+        }
+        cairo_destroy(cr);
+    }
+    
+    chart_mark_plotted(config);
+    return TRUE;
+}
+
+// Legend layout
+#define LEGEND_PADDING 10
+#define LEGEND_ITEM_HEIGHT 20
+#define LEGEND_SWATCH_SIZE 12
+#define LEGEND_TEXT_PADDING 5
+#define LEGEND_WIDTH 150
+
+// Compute the legend box; returns FALSE when no series is visible
+static gboolean chart_legend_rect(ChartConfig *config, int width, GdkRectangle *rect) {
+    int visible_count = 0;
+    for (guint i = 0; i < config->series->len; i++) {
+        ChartSeries *series = g_ptr_array_index(config->series, i);
+        if (series->visible) visible_count++;
+    }
+    
+    if (visible_count == 0) return FALSE;
+    
+    rect->width = LEGEND_WIDTH;
+    rect->height = visible_count * LEGEND_ITEM_HEIGHT + 2 * LEGEND_PADDING;
+    rect->x = width - LEGEND_WIDTH - LEGEND_PADDING;
+    rect->y = LEGEND_PADDING;
+    return TRUE;
+}
+
+// Draw the chart legend
+void chart_draw_legend(ChartConfig *config, cairo_t *cr, int width, int height) {
+    if (!config || !config->series) return;
+    
+    const int legend_padding = LEGEND_PADDING;
+    const int legend_item_height = LEGEND_ITEM_HEIGHT;
+    const int legend_swatch_size = LEGEND_SWATCH_SIZE;
+    const int legend_text_padding = LEGEND_TEXT_PADDING;
+    
+    // Calculate legend dimensions
+    GdkRectangle rect;
+    if (!chart_legend_rect(config, width, &rect)) return;
+    
+    int legend_width = rect.width;
+    int legend_height = rect.height;
+    int legend_x = rect.x;
+    int legend_y = rect.y;
+    
+    // Draw legend background
+    GdkRGBA bg = {0.1, 0.1, 0.1, 0.8};
+    gdk_cairo_set_source_rgba(cr, &bg);
+    cairo_rectangle(cr, legend_x, legend_y, legend_width, legend_height);
+    cairo_fill(cr);
+    
+    // Draw legend items
+    int item_y = legend_y + legend_padding;
+    for (guint i = 0; i < config->series->len; i++) {
+        ChartSeries *series = g_ptr_array_index(config->series, i);
+        if (series->visible) {
+            // Draw color swatch
+            gdk_cairo_set_source_rgba(cr, &series->color);
+            cairo_rectangle(cr, legend_x + legend_padding, item_y, 
+                          legend_swatch_size, legend_swatch_size);
+            cairo_fill(cr);
             
-            // Queue redraw
-            gtk_widget_queue_draw(widget);
+            // Draw label
+            gdk_cairo_set_source_rgba(cr, &config->text_color);
+            PangoLayout *layout = chart_text_layout(config, cr, series->label, NULL);
+            cairo_move_to(cr, legend_x + legend_padding + legend_swatch_size + legend_text_padding, 
+                         item_y - 3);
+            pango_cairo_show_layout(cr, layout);
+            
+            item_y += legend_item_height;
         }
+    }
+}
+
+
+// Render the background/grid and legend layers if the cache does not match the target
+static gboolean chart_ensure_layers(ChartConfig *config, cairo_t *target_cr, int width, int height) {
+    ChartLayerCache *layers = &config->layers;
+    int scale = chart_target_scale(target_cr);
+    
+    if (layers->valid && layers->width == width && layers->height == height && layers->scale == scale) {
+        return TRUE;
+    }
+    
+    chart_invalidate_layers(config);
+    
+    // Similar surfaces carry the target's device scale, so layers stay sharp on HiDPI
+    if (width <= 0 || height <= 0) return FALSE;
+    
+    cairo_surface_t *target = cairo_get_target(target_cr);
+    layers->background = cairo_surface_create_similar(target, CAIRO_CONTENT_COLOR, width, height);
+    cairo_t *layer_cr = cairo_create(layers->background);
+    chart_draw_grid(config, layer_cr, width, height);
+    cairo_destroy(layer_cr);
+    
+    // The legend layer only covers the legend box
+    GdkRectangle rect;
+    if (chart_legend_rect(config, width, &rect)) {
+        layers->legend = cairo_surface_create_similar(target, CAIRO_CONTENT_COLOR_ALPHA,
+                                                      rect.width, rect.height);
+        layer_cr = cairo_create(layers->legend);
+        cairo_translate(layer_cr, -rect.x, -rect.y);
+        chart_draw_legend(config, layer_cr, width, height);
+        cairo_destroy(layer_cr);
+        layers->legend_x = rect.x;
+        layers->legend_y = rect.y;
+    }
+    
+    layers->width = width;
+    layers->height = height;
+    layers->scale = scale;
+    layers->valid = TRUE;
+    return TRUE;
+}
+
+// Format a data x (timestamp) for the tooltip; returns the length written
+static int chart_format_time(char *buffer, size_t size, double x) {
+    time_t t = (time_t)x;
+    struct tm tm_info;
+    localtime_r(&t, &tm_info);
+    return (int)strftime(buffer, size, "%d/%m %H:%M:%S", &tm_info);
+}
+
+// Place the crosshair on the sample nearest to the hovered data x and build the
+// tooltip. Each visible series costs one binary search, however long it is.
+static void chart_hover_place(ChartConfig *config, GtkWidget *widget, int width, int height) {
+    ChartHover *hover = &config->hover;
+    hover->active = FALSE;
+    hover->marker_count = 0;
+    hover->viewport_revision = config->viewport->revision;
+    hover->data_revision = config->autoscale.revision;
+    hover->min_y = config->min_y;
+    hover->max_y = config->max_y;
+    hover->width = width;
+    hover->height = height;
+    
+    double view_start, view_end;
+    chart_get_visible_range(config, &view_start, &view_end);
+    if (width <= 0 || height <= 0 || view_end <= view_start || config->max_y <= config->min_y) return;
+    
+    double scale_x = width / (view_end - view_start);
+    double x = hover->data_x;
+    ChartYMap y_map;
+    chart_y_map_init(&y_map, config, height);
+    
+    double snapped;
+    size_t len;
+    if (config->type == CHART_TYPE_CANDLE) {
+        guint n = config->candles->len;
+        if (n == 0) return;
+        
+        const CandleData *candles = (const CandleData *)config->candles->data;
+        guint i = candle_lower_bound(candles, n, x, config->candle_interval);
+        if (i == n) i = n - 1;
+        
+        const CandleData *c = &candles[i];
+        snapped = c->timestamp + config->candle_interval / 2.0;
+        len = chart_format_time(hover->text, sizeof(hover->text), c->timestamp);
+        snprintf(hover->text + len, sizeof(hover->text) - len,
+                 "\nO %.2f  H %.2f\nL %.2f  C %.2f", c->open, c->high, c->low, c->close);
+        
+        hover->marker_y[0] = chart_y_map(&y_map, c->close);
+        hover->marker_color[0] = c->close >= c->open ? CANDLE_UP_COLOR : CANDLE_DOWN_COLOR;
+        hover->marker_count = 1;
+    } else {
+        // Snap to the sample closest in time across the visible series
+        double best = G_MAXDOUBLE;
+        snapped = x;
+        for (guint s = 0; s < config->series->len; s++) {
+            ChartSeries *series = g_ptr_array_index(config->series, s);
+            if (!series->visible || !series->data || series->data->len == 0) continue;
+            
+            const ChartDataPoint *points = (const ChartDataPoint *)series->data->data;
+            guint i = series_nearest(points, series->data->len, x);
+            if (fabs(points[i].x - x) < best) {
+                best = fabs(points[i].x - x);
+                snapped = points[i].x;
+            }
+        }
+        if (best == G_MAXDOUBLE) return;
+        
+        // Every series reports its sample nearest to that instant
+        len = chart_format_time(hover->text, sizeof(hover->text), snapped);
+        for (guint s = 0; s < config->series->len; s++) {
+            ChartSeries *series = g_ptr_array_index(config->series, s);
+            if (!series->visible || !series->data || series->data->len == 0) continue;
+            
+            const ChartDataPoint *points = (const ChartDataPoint *)series->data->data;
+            const ChartDataPoint *p = &points[series_nearest(points, series->data->len, snapped)];
+            if (len < sizeof(hover->text)) {
+                len += snprintf(hover->text + len, sizeof(hover->text) - len, "\n%s: %.2f", series->label, p->y);
+            }
+            
+            if (hover->marker_count < CHART_HOVER_MAX_MARKERS) {
+                hover->marker_y[hover->marker_count] = chart_y_map(&y_map, p->y);
+                hover->marker_color[hover->marker_count] = series->color;
+                hover->marker_count++;
+            }
+        }
+    }
+    
+    hover->line_x = floor((snapped - view_start) * scale_x) + 0.5;
+    if (hover->line_x < 0 || hover->line_x > width) return;
+    
+    // Tooltip beside the crosshair, flipped to the left near the right edge. The
+    // text changes on every move, so it bypasses the layout cache and is shaped
+    // once here into the layout chart_draw_hover() shows.
+    if (!hover->layout) {
+        hover->layout = gtk_widget_create_pango_layout(widget, NULL);
+    }
+    pango_layout_set_text(hover->layout, hover->text, -1);
+    int text_width, text_height;
+    pango_layout_get_pixel_size(hover->layout, &text_width, &text_height);
+    
+    hover->box.width = text_width + 2 * CHART_HOVER_PADDING;
+    hover->box.height = text_height + 2 * CHART_HOVER_PADDING;
+    hover->box.x = (int)hover->line_x + CHART_HOVER_OFFSET;
+    if (hover->box.x + hover->box.width > width) {
+        hover->box.x = (int)hover->line_x - CHART_HOVER_OFFSET - hover->box.width;
+    }
+    hover->box.y = CHART_PADDING;
+    
+    // Damage area: a strip wide enough for the markers plus the tooltip
+    int half = (int)ceil(CHART_MARKER_RADIUS) + 2;
+    GdkRectangle strip = { (int)hover->line_x - half, 0, 2 * half + 1, height };
+    gdk_rectangle_union(&strip, &hover->box, &hover->bounds);
+    hover->active = TRUE;
+}
+
+// Whether the overlay was placed for another viewport, data, y range or size
+static gboolean chart_hover_stale(const ChartConfig *config, int width, int height) {
+    const ChartHover *hover = &config->hover;
+    return hover->viewport_revision != config->viewport->revision ||
+           hover->data_revision != config->autoscale.revision ||
+           hover->min_y != config->min_y || hover->max_y != config->max_y ||
+           hover->width != width || hover->height != height;
+}
+
+// Redraw only where the overlay was and where it is now
+static void chart_hover_damage(GtkWidget *widget, const ChartHover *hover,
+                               const GdkRectangle *old_bounds, gboolean was_active) {
+    if (was_active) {
+        gtk_widget_queue_draw_area(widget, old_bounds->x, old_bounds->y,
+                                   old_bounds->width, old_bounds->height);
+    }
+    if (hover->active) {
+        gtk_widget_queue_draw_area(widget, hover->bounds.x, hover->bounds.y,
+                                   hover->bounds.width, hover->bounds.height);
+    }
+}
+
+// Draw the crosshair, the highlighted samples and the tooltip
+static void chart_draw_hover(ChartConfig *config, cairo_t *cr, int height) {
+    const ChartHover *hover = &config->hover;
+    
+    GdkRGBA line_color = config->text_color;
+    line_color.alpha = 0.5;
+    gdk_cairo_set_source_rgba(cr, &line_color);
+    cairo_set_line_width(cr, 1.0);
+    cairo_move_to(cr, hover->line_x, 0);
+    cairo_line_to(cr, hover->line_x, height);
+    cairo_stroke(cr);
+    
+    for (int i = 0; i < hover->marker_count; i++) {
+        gdk_cairo_set_source_rgba(cr, &hover->marker_color[i]);
+        cairo_arc(cr, hover->line_x, hover->marker_y[i], CHART_MARKER_RADIUS + 1, 0, 2 * G_PI);
+        cairo_fill(cr);
+    }
+    
+    GdkRGBA bg = {0.1, 0.1, 0.1, 0.85};
+    gdk_cairo_set_source_rgba(cr, &bg);
+    cairo_rectangle(cr, hover->box.x, hover->box.y, hover->box.width, hover->box.height);
+    cairo_fill(cr);
+    
+    gdk_cairo_set_source_rgba(cr, &config->text_color);
+    cairo_move_to(cr, hover->box.x + CHART_HOVER_PADDING, hover->box.y + CHART_HOVER_PADDING);
+    pango_cairo_show_layout(cr, hover->layout);
+}
+
+// Draw the whole chart onto any cairo target, bypassing the widget layer caches
+void chart_render(ChartConfig *config, cairo_t *cr, int width, int height) {
+    if (!config || !cr || width <= 0 || height <= 0) return;
+    
+    chart_autoscale(config);
+    chart_draw_grid(config, cr, width, height);
+    chart_draw_series(config, cr, width, height);
+    chart_draw_legend(config, cr, width, height);
+}
+
+// Draw a frame through the layer caches, as the widget does: only what changed
+// since the previous frame on the same target is replotted
+void chart_draw_cached(ChartConfig *config, cairo_t *cr, int width, int height) {
+    if (!config || !cr || width <= 0 || height <= 0) return;
+    
+    config->text_stats.created_last_frame = 0;
+    
+    // Cheap unless the visible extremes moved past a tick
+    chart_autoscale(config);
+    
+    if (!chart_ensure_layers(config, cr, width, height) ||
+        !chart_update_data_layer(config, cr, width, height)) {
+        // Nothing to cache (empty range): draw everything directly
+        chart_render(config, cr, width, height);
+        return;
+    }
+    
+    // Composite the cached background, the data layer, then the cached legend
+    cairo_set_source_surface(cr, config->layers.background, 0, 0);
+    cairo_paint(cr);
+    
+    cairo_set_source_surface(cr, config->data_layer.surface, 0, 0);
+    cairo_paint(cr);
+    
+    if (config->layers.legend) {
+        cairo_set_source_surface(cr, config->layers.legend,
+                                 config->layers.legend_x, config->layers.legend_y);
+        cairo_paint(cr);
+    }
+}
+
+// Main drawing callback
+gboolean chart_draw_cb(GtkWidget *widget, cairo_t *cr, gpointer user_data) {
+    ChartConfig *config = (ChartConfig *)user_data;
+    if (!config) return FALSE;
+    
+    GtkAllocation allocation;
+    gtk_widget_get_allocation(widget, &allocation);
+    int width = allocation.width;
+    int height = allocation.height;
+    
+    // Any draw (including the one GTK does on map) brings the chart up to date
+    config->dirty = FALSE;
+    chart_draw_cached(config, cr, width, height);
+    
+    // Pointer moves only damage the overlay, so those frames just recomposite its
+    // area. New data, autoscale or a linked scroll redraw the whole chart, and the
+    // overlay follows its sample there.
+    if (config->hover.pointer_in && chart_hover_stale(config, width, height)) {
+        chart_hover_place(config, widget, width, height);
+    }
+    if (config->hover.active) {
+        chart_draw_hover(config, cr, height);
+    }
+    
+    // Steady-state frames should not shape any text
+    if (config->text_stats.created_last_frame > 0) {
+        g_debug("Chart '%s': %u text layouts created this frame, %u cached",
+                config->title ? config->title : "", config->text_stats.created_last_frame,
+                g_hash_table_size(config->text_cache));
+    }
+    
+    return FALSE;
+}
+
+// Mouse motion event handler
+gboolean chart_motion_notify_cb(GtkWidget *widget, GdkEventMotion *event, gpointer user_data) {
+    ChartConfig *config = (ChartConfig*)user_data;
+    if (!config) return FALSE;
+    
+    // Handle panning while the left button drag is active
+    if (config->dragging && (event->state & GDK_BUTTON1_MASK)) {
+        double dx = event->x - config->drag_last_x;
+        config->drag_last_x = event->x;
         
-        last_x = event->x;
+        ChartViewport *viewport = config->viewport;
+        double visible_range = viewport->view_end - viewport->view_start;
+        int width = gtk_widget_get_allocated_width(widget);
+        if (width <= 0 || dx == 0) return TRUE;
+        
+        // Dragging right moves the view towards earlier data, on every linked chart
+        viewport->pan_offset -= dx * (visible_range / width);
+        chart_viewport_update(viewport);
     }
     
+    // Move the crosshair to the data x under the pointer
+    int width = gtk_widget_get_allocated_width(widget);
+    int height = gtk_widget_get_allocated_height(widget);
+    double view_start, view_end;
+    chart_get_visible_range(config, &view_start, &view_end);
+    if (width <= 0 || view_end <= view_start) return TRUE;
+    
+    GdkRectangle old_bounds = config->hover.bounds;
+    gboolean was_active = config->hover.active;
+    config->hover.pointer_in = TRUE;
+    config->hover.data_x = view_start + event->x * (view_end - view_start) / width;
+    chart_hover_place(config, widget, width, height);
+    chart_hover_damage(widget, &config->hover, &old_bounds, was_active);
+    
     return TRUE;
 }
 
+// Pointer left the chart: remove the crosshair
+gboolean chart_leave_notify_cb(GtkWidget *widget, GdkEventCrossing *event, gpointer user_data) {
+    ChartConfig *config = (ChartConfig *)user_data;
+    if (!config) return FALSE;
+    
+    config->hover.pointer_in = FALSE;
+    if (!config->hover.active) return FALSE;
+    
+    config->hover.active = FALSE;
+    chart_hover_damage(widget, &config->hover, &config->hover.bounds, TRUE);
+    return FALSE;
+}
+
 // Button press event handler
 gboolean chart_button_press_cb(GtkWidget *widget, GdkEventButton *event, gpointer user_data) {
-    // Can be implemented for handling button press events
+    ChartConfig *config = (ChartConfig *)user_data;
+    if (!config) return FALSE;
+    
+    // Double click resets the view
+    if (event->button == 1 && event->type == GDK_2BUTTON_PRESS) {
+        chart_reset_zoom(config);
+        return TRUE;
+    }
+    
+    // Start a pan drag from the current pointer position
+    if (event->button == 1) {
+        config->dragging = TRUE;
+        config->drag_last_x = event->x;
+        return TRUE;
+    }
+    
     return FALSE;
 }
 
 // Button release event handler
 gboolean chart_button_release_cb(GtkWidget *widget, GdkEventButton *event, gpointer user_data) {
-    // Can be implemented for handling button release events
+    ChartConfig *config = (ChartConfig *)user_data;
+    if (!config) return FALSE;
+    
+    if (event->button == 1 && config->dragging) {
+        config->dragging = FALSE;
+        return TRUE;
+    }
+    
     return FALSE;
 }
 
@@ -462,38 +2031,154 @@ gboolean chart_scroll_cb(GtkWidget *widget, GdkEventScroll *event, gpointer user
     ChartConfig *config = (ChartConfig *)user_data;
     if (!config) return FALSE;
     
+    ChartViewport *viewport = config->viewport;
     double zoom_factor = (event->direction == GDK_SCROLL_UP) ? 1.1 : 0.9;
     
     // Calculate new zoom level
-    double new_zoom = config->zoom_level * zoom_factor;
+    double new_zoom = viewport->zoom_level * zoom_factor;
     
     // Limit zoom levels
     if (new_zoom < 1.0) new_zoom = 1.0;
     if (new_zoom > 20.0) new_zoom = 20.0;
     
-    if (new_zoom != config->zoom_level) {
-        // Get mouse position in data coordinates
-        double mouse_x = event->x;
+    if (new_zoom != viewport->zoom_level) {
         double widget_width = gtk_widget_get_allocated_width(widget);
-        double range = config->max_x - config->min_x;
-        double visible_range = range / config->zoom_level;
-        double data_x = config->min_x + (mouse_x / widget_width) * visible_range;
-        
-        // Update zoom level
-        config->zoom_level = new_zoom;
-        
-        // Adjust pan to zoom toward mouse position
-        double new_visible_range = range / config->zoom_level;
-        config->pan_offset = (data_x - config->min_x) * (1.0 - (new_visible_range / visible_range));
+        if (widget_width <= 0) return TRUE;
         
-        // Clamp pan offset to valid range
-        double max_pan = range * (1.0 - 1.0/config->zoom_level);
-        if (config->pan_offset > max_pan) config->pan_offset = max_pan;
-        if (config->pan_offset < 0) config->pan_offset = 0;
+        // Data x under the pointer, within the current visible window
+        double fraction = event->x / widget_width;
+        double view_start, view_end;
+        chart_get_visible_range(config, &view_start, &view_end);
+        double data_x = view_start + fraction * (view_end - view_start);
         
-        // Queue redraw
-        gtk_widget_queue_draw(widget);
+        // Keep the same data x under the pointer after zooming; linked charts follow
+        chart_viewport_zoom_at(viewport, new_zoom, data_x, fraction);
     }
     
     return TRUE;
 }
+
+// Resolve the export size: explicit, else the widget allocation, else the default
+static void chart_export_size(const ChartConfig *config, int *width, int *height) {
+    if (*width <= 0) {
+        *width = config->drawing_area ? gtk_widget_get_allocated_width(config->drawing_area) : 0;
+        if (*width <= 1) *width = CHART_EXPORT_DEFAULT_WIDTH;
+    }
+    if (*height <= 0) {
+        *height = config->drawing_area ? gtk_widget_get_allocated_height(config->drawing_area) : 0;
+        if (*height <= 1) *height = CHART_EXPORT_DEFAULT_HEIGHT;
+    }
+}
+
+// Render a chart to an image file
+gboolean chart_export(ChartConfig *config, ChartExportFormat format, const char *filename,
+                      int width, int height, GError **error) {
+    if (!config || !filename) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "No chart or file name to export");
+        return FALSE;
+    }
+    
+    chart_export_size(config, &width, &height);
+    
+    cairo_surface_t *surface;
+    if (format == CHART_EXPORT_SVG) {
+        surface = cairo_svg_surface_create(filename, width, height);
+    } else {
+        surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    }
+    
+    cairo_t *cr = cairo_create(surface);
+    chart_render(config, cr, width, height);
+    cairo_destroy(cr);
+    
+    // SVG output is written as the surface is finished
+    cairo_status_t status;
+    if (format == CHART_EXPORT_SVG) {
+        cairo_surface_finish(surface);
+        status = cairo_surface_status(surface);
+    } else {
+        status = cairo_surface_write_to_png(surface, filename);
+    }
+    cairo_surface_destroy(surface);
+    
+    if (status != CAIRO_STATUS_SUCCESS) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Could not export chart to %s: %s",
+                    filename, cairo_status_to_string(status));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Render a chart to a PNG file
+gboolean chart_export_to_png(ChartConfig *config, const char *filename, int width, int height, GError **error) {
+    return chart_export(config, CHART_EXPORT_PNG, filename, width, height, error);
+}
+
+// Render a chart to an SVG file
+gboolean chart_export_to_svg(ChartConfig *config, const char *filename, int width, int height, GError **error) {
+    return chart_export(config, CHART_EXPORT_SVG, filename, width, height, error);
+}
+
+// Work item of an asynchronous export
+typedef struct {
+    ChartConfig *chart;   // Private copy rendered by the worker
+    ChartExportFormat format;
+    char *filename;
+    int width;
+    int height;
+} ChartExportJob;
+
+static void chart_export_job_free(gpointer data) {
+    ChartExportJob *job = data;
+    chart_config_free(job->chart);
+    g_free(job->filename);
+    g_free(job);
+}
+
+static void chart_export_thread(GTask *task, gpointer source_object, gpointer task_data,
+                                GCancellable *cancellable) {
+    ChartExportJob *job = task_data;
+    GError *error = NULL;
+    
+    if (g_task_return_error_if_cancelled(task)) return;
+    
+    if (chart_export(job->chart, job->format, job->filename, job->width, job->height, &error)) {
+        g_task_return_boolean(task, TRUE);
+    } else {
+        g_task_return_error(task, error);
+    }
+}
+
+// Export a chart on a worker thread. Must be called from the thread that owns
+// the chart; the callback runs in the caller's main context.
+void chart_export_async(ChartConfig *config, ChartExportFormat format, const char *filename,
+                        int width, int height, GCancellable *cancellable,
+                        GAsyncReadyCallback callback, gpointer user_data) {
+    GTask *task = g_task_new(NULL, cancellable, callback, user_data);
+    g_task_set_source_tag(task, chart_export_async);
+    
+    if (!config || !filename) {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                                "No chart or file name to export");
+        g_object_unref(task);
+        return;
+    }
+    
+    ChartExportJob *job = g_new0(ChartExportJob, 1);
+    job->width = width;
+    job->height = height;
+    chart_export_size(config, &job->width, &job->height);
+    job->chart = chart_config_copy(config);
+    job->format = format;
+    job->filename = g_strdup(filename);
+    
+    g_task_set_task_data(task, job, chart_export_job_free);
+    g_task_run_in_thread(task, chart_export_thread);
+    g_object_unref(task);
+}
+
+// Get the result of chart_export_async()
+gboolean chart_export_finish(GAsyncResult *result, GError **error) {
+    g_return_val_if_fail(g_task_is_valid(result, NULL), FALSE);
+    return g_task_propagate_boolean(G_TASK(result), error);
+}
@@ -0,0 +1,222 @@
+#include "fee_history.h"
+#include "file_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static size_t ring_bytes(size_t capacity) {
+    return sizeof(FeeHistoryHeader) + capacity * sizeof(FeeHistoryPoint);
+}
+
+// Reserva los bloques del anillo sin escribirlos. Una página proyectada sin
+// bloque detrás provoca SIGBUS al escribirla con el disco lleno, así que el
+// fallo tiene que aparecer aquí, donde se puede volver al mapa anónimo.
+static int ring_reserve(int fd, size_t capacity) {
+    int err = posix_fallocate(fd, 0, (off_t)ring_bytes(capacity));
+    if (err != 0) {
+        errno = err;
+        return 0;
+    }
+    return 1;
+}
+
+// Proyecta el anillo y, si es nuevo, escribe la cabecera. Con fd < 0 el
+// mapa es anónimo.
+static int history_map(FeeHistory *history, int fd, size_t capacity, int fresh) {
+    size_t size = ring_bytes(capacity);
+    void *map = fd >= 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                        : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) return 0;
+    
+    history->header = map;
+    history->points = (FeeHistoryPoint *)(history->header + 1);
+    history->map_size = size;
+    history->fd = fd;
+    
+    if (fresh) {
+        history->header->magic = FEE_HISTORY_MAGIC;
+        history->header->version = FEE_HISTORY_VERSION;
+        history->header->capacity = capacity;
+        history->header->head = 0;
+        history->header->size = 0;
+    }
+    return 1;
+}
+
+// Indica si la cabecera leída describe un anillo válido de `file_size` bytes
+static int header_valid(const FeeHistoryHeader *header, off_t file_size) {
+    return header->magic == FEE_HISTORY_MAGIC &&
+           header->version == FEE_HISTORY_VERSION &&
+           header->capacity > 0 && header->capacity <= FEE_HISTORY_MAX_CAPACITY &&
+           header->head < header->capacity && header->size <= header->capacity &&
+           (uint64_t)file_size == ring_bytes(header->capacity);
+}
+
+static int history_open_file(FeeHistory *history, const char *path, size_t capacity, int resize);
+
+// Copia los puntos más recientes a un anillo nuevo con otra capacidad y lo
+// deja en lugar del anterior. Solo ocurre cuando cambia la capacidad.
+static int history_resize(FeeHistory *history, FeeHistory *old, const char *path, size_t capacity) {
+    char tmp_path[4096];
+    int len = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    if (len < 0 || (size_t)len >= sizeof(tmp_path)) return 0;
+    unlink(tmp_path);
+    
+    if (!history_open_file(history, tmp_path, capacity, 0)) return 0;
+    
+    size_t size = fee_history_size(old);
+    size_t keep = size < capacity ? size : capacity;
+    for (size_t i = size - keep; i < size; i++) {
+        const FeeHistoryPoint *point = fee_history_point(old, i);
+        fee_history_add(history, point->fastest, point->halfHour, point->hour, (time_t)point->timestamp);
+    }
+    
+    if (rename(tmp_path, path) != 0) {
+        fee_history_close(history);
+        unlink(tmp_path);
+        return 0;
+    }
+    return 1;
+}
+
+static int history_open_file(FeeHistory *history, const char *path, size_t capacity, int resize) {
+    if (!file_make_parent_dirs(path)) return 0;
+    
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return 0;
+    
+    // Solo una instancia escribe en el anillo
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        errno = EWOULDBLOCK;
+        return 0;
+    }
+    
+    FeeHistoryHeader header;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+    ssize_t read_bytes = pread(fd, &header, sizeof(header), 0);
+    int valid = read_bytes == (ssize_t)sizeof(header) && header_valid(&header, st.st_size);
+    
+    // Se conserva la capacidad del archivo salvo que se pida otra
+    if (valid && (!resize || header.capacity == capacity)) {
+        // Los anillos creados dispersos por versiones anteriores también se reservan
+        if (ring_reserve(fd, header.capacity) && history_map(history, fd, header.capacity, 0)) return 1;
+        close(fd);
+        return 0;
+    }
+    
+    if (valid) {
+        FeeHistory old;
+        if (!history_map(&old, fd, header.capacity, 0)) {
+            close(fd);
+            return 0;
+        }
+        int ok = history_resize(history, &old, path, capacity);
+        fee_history_close(&old);
+        return ok;
+    }
+    
+    // Solo se reinicia un archivo vacío o un anillo dañado o de otra versión;
+    // cualquier otro archivo (p. ej. una ruta equivocada) no se toca
+    int ours = st.st_size == 0 ||
+               (read_bytes == (ssize_t)sizeof(header) && header.magic == FEE_HISTORY_MAGIC);
+    if (!ours) {
+        close(fd);
+        errno = EINVAL;
+        return 0;
+    }
+    
+    // Se crea vacío con los bloques reservados pero sin escribir los puntos
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)ring_bytes(capacity)) != 0) {
+        close(fd);
+        return 0;
+    }
+    if (!ring_reserve(fd, capacity) || !history_map(history, fd, capacity, 1)) {
+        // Vacío se vuelve a reconocer como propio en la próxima apertura
+        int saved = errno;
+        int truncated = ftruncate(fd, 0);
+        (void)truncated;  // Si falla, el archivo sin cabecera se tratará como ajeno
+        close(fd);
+        errno = saved;
+        return 0;
+    }
+    return 1;
+}
+
+int fee_history_open(FeeHistory *history, const char *path, size_t capacity, int resize) {
+    memset(history, 0, sizeof(*history));
+    history->fd = -1;
+    
+    if (capacity < 2) capacity = 2;
+    if (capacity > FEE_HISTORY_MAX_CAPACITY) capacity = FEE_HISTORY_MAX_CAPACITY;
+    
+    if (path) {
+        if (history_open_file(history, path, capacity, resize)) return 1;
+        fprintf(stderr, "No se pudo usar el historial %s (%s); se mantendrá solo en memoria\n",
+                path, strerror(errno));
+    }
+    return history_map(history, -1, capacity, 1);
+}
+
+int fee_history_default_path(char *buffer, size_t size) {
+    const char *home = getenv("HOME");
+    if (!home || !*home) return 0;
+    
+    int len = snprintf(buffer, size, "%s/.local/share/btc-fee-tracker/history.ring", home);
+    return len > 0 && (size_t)len < size;
+}
+
+void fee_history_add(FeeHistory *history, double fastest, double halfHour, double hour, time_t timestamp) {
+    FeeHistoryHeader *header = history->header;
+    if (!header) return;
+    
+    FeeHistoryPoint *point = &history->points[header->head];
+    point->fastest = fastest;
+    point->halfHour = halfHour;
+    point->hour = hour;
+    point->timestamp = (int64_t)timestamp;
+    
+    // La cabecera se actualiza después del punto
+    header->head = (header->head + 1) % header->capacity;
+    if (header->size < header->capacity) header->size++;
+}
+
+size_t fee_history_size(const FeeHistory *history) {
+    return history->header ? (size_t)history->header->size : 0;
+}
+
+const FeeHistoryPoint *fee_history_point(const FeeHistory *history, size_t i) {
+    const FeeHistoryHeader *header = history->header;
+    size_t oldest = (size_t)((header->head + header->capacity - header->size) % header->capacity);
+    return &history->points[(oldest + i) % header->capacity];
+}
+
+size_t fee_history_lower_bound(const FeeHistory *history, time_t timestamp) {
+    size_t lo = 0, hi = fee_history_size(history);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (fee_history_point(history, mid)->timestamp < (int64_t)timestamp) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void fee_history_close(FeeHistory *history) {
+    if (history->header) munmap(history->header, history->map_size);
+    if (history->fd >= 0) close(history->fd);
+    memset(history, 0, sizeof(*history));
+    history->fd = -1;
+}
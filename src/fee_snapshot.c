@@ -0,0 +1,67 @@
+#include "fee_snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+
+FeeSnapshot *fee_snapshot_new(const FeeSnapshot *base) {
+    FeeSnapshot *snapshot = calloc(1, sizeof(FeeSnapshot));
+    if (!snapshot) return NULL;
+
+    if (base) {
+        snapshot->metrics = base->metrics;
+        snapshot->depth = mempool_depth_ref(base->depth);
+        memcpy(snapshot->source, base->source, sizeof(snapshot->source));
+    }
+    snapshot->timestamp = time(NULL);
+    atomic_init(&snapshot->refcount, 1);
+    return snapshot;
+}
+
+FeeSnapshot *fee_snapshot_ref(FeeSnapshot *snapshot) {
+    if (snapshot) atomic_fetch_add(&snapshot->refcount, 1);
+    return snapshot;
+}
+
+void fee_snapshot_unref(FeeSnapshot *snapshot) {
+    if (snapshot && atomic_fetch_sub(&snapshot->refcount, 1) == 1) {
+        mempool_depth_unref(snapshot->depth);
+        free(snapshot);
+    }
+}
+
+void fee_snapshot_set_source(FeeSnapshot *snapshot, const char *source) {
+    if (!snapshot) return;
+    strncpy(snapshot->source, source ? source : "", sizeof(snapshot->source) - 1);
+    snapshot->source[sizeof(snapshot->source) - 1] = '\0';
+}
+
+void fee_snapshot_set_depth(FeeSnapshot *snapshot, MempoolDepth *depth) {
+    if (!snapshot) {
+        mempool_depth_unref(depth);
+        return;
+    }
+    mempool_depth_unref(snapshot->depth);
+    snapshot->depth = depth;
+}
+
+void fee_snapshot_seal(FeeSnapshot *snapshot, const FeeSnapshot *previous) {
+    if (!snapshot) return;
+
+    if (!previous) {
+        snapshot->sequence = 1;
+        snapshot->version = 1;
+        return;
+    }
+
+    snapshot->sequence = previous->sequence + 1;
+    // Comparación del bloque completo de métricas, sin recorrer campos
+    if (memcmp(&snapshot->metrics, &previous->metrics, sizeof(FeeMetrics)) == 0 &&
+        mempool_depth_equal(snapshot->depth, previous->depth)) {
+        snapshot->version = previous->version;
+    } else {
+        snapshot->version = previous->version + 1;
+    }
+}
+
+int fee_snapshot_changed(const FeeSnapshot *snapshot, uint64_t seen_version) {
+    return snapshot && snapshot->version != seen_version;
+}
@@ -0,0 +1,382 @@
+#include "fee_stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Capacidad inicial de las colas cuando la ventana no tiene límite de muestras
+#define STAT_DEQUE_MIN_CAPACITY 16
+
+/* ---------- Cola doble circular ---------- */
+
+static int deque_reserve(StatDeque *dq, size_t capacity) {
+    if (capacity <= dq->capacity) return 1;
+
+    StatSample *items = malloc(capacity * sizeof(StatSample));
+    if (!items) return 0;
+
+    // Copiar en orden para que head vuelva a 0
+    for (size_t i = 0; i < dq->len; i++) {
+        items[i] = dq->items[(dq->head + i) % dq->capacity];
+    }
+    free(dq->items);
+    dq->items = items;
+    dq->capacity = capacity;
+    dq->head = 0;
+    return 1;
+}
+
+static int deque_push_back(StatDeque *dq, StatSample s) {
+    if (dq->len == dq->capacity) {
+        size_t capacity = dq->capacity ? dq->capacity * 2 : STAT_DEQUE_MIN_CAPACITY;
+        if (!deque_reserve(dq, capacity)) return 0;
+    }
+    dq->items[(dq->head + dq->len) % dq->capacity] = s;
+    dq->len++;
+    return 1;
+}
+
+static StatSample *deque_front(const StatDeque *dq) {
+    return &dq->items[dq->head];
+}
+
+static StatSample *deque_back(const StatDeque *dq) {
+    return &dq->items[(dq->head + dq->len - 1) % dq->capacity];
+}
+
+static StatSample deque_pop_front(StatDeque *dq) {
+    StatSample s = dq->items[dq->head];
+    dq->head = (dq->head + 1) % dq->capacity;
+    dq->len--;
+    return s;
+}
+
+static void deque_pop_back(StatDeque *dq) {
+    dq->len--;
+}
+
+/* ---------- Estimador P² ---------- */
+
+static void p2_init(P2Quantile *est, double p) {
+    memset(est, 0, sizeof(*est));
+    est->p = p;
+}
+
+static void p2_reset(P2Quantile *est) {
+    p2_init(est, est->p);
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+static double p2_parabolic(const P2Quantile *est, int i, double d) {
+    const double *q = est->q;
+    const double *n = est->n;
+    return q[i] + d / (n[i + 1] - n[i - 1]) *
+           ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+            (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+}
+
+static double p2_linear(const P2Quantile *est, int i, int d) {
+    return est->q[i] + d * (est->q[i + d] - est->q[i]) / (est->n[i + d] - est->n[i]);
+}
+
+static void p2_add(P2Quantile *est, double t, double x) {
+    if (est->count == 0) est->started_at = t;
+
+    // Las cinco primeras muestras inicializan los marcadores
+    if (est->count < 5) {
+        est->q[est->count++] = x;
+        if (est->count == 5) {
+            double p = est->p;
+            qsort(est->q, 5, sizeof(double), compare_doubles);
+            for (int i = 0; i < 5; i++) est->n[i] = i + 1;
+            est->np[0] = 1;
+            est->np[1] = 1 + 2 * p;
+            est->np[2] = 1 + 4 * p;
+            est->np[3] = 3 + 2 * p;
+            est->np[4] = 5;
+            est->dn[0] = 0;
+            est->dn[1] = p / 2;
+            est->dn[2] = p;
+            est->dn[3] = (1 + p) / 2;
+            est->dn[4] = 1;
+        }
+        return;
+    }
+
+    // Localizar la celda de la muestra
+    int k;
+    if (x < est->q[0]) {
+        est->q[0] = x;
+        k = 0;
+    } else if (x >= est->q[4]) {
+        est->q[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (k < 3 && x >= est->q[k + 1]) k++;
+    }
+
+    for (int i = k + 1; i < 5; i++) est->n[i] += 1;
+    for (int i = 0; i < 5; i++) est->np[i] += est->dn[i];
+
+    // Ajustar los marcadores centrales
+    for (int i = 1; i <= 3; i++) {
+        double d = est->np[i] - est->n[i];
+        if ((d >= 1 && est->n[i + 1] - est->n[i] > 1) ||
+            (d <= -1 && est->n[i - 1] - est->n[i] < -1)) {
+            int s = d > 0 ? 1 : -1;
+            double qp = p2_parabolic(est, i, s);
+            if (est->q[i - 1] < qp && qp < est->q[i + 1]) {
+                est->q[i] = qp;
+            } else {
+                est->q[i] = p2_linear(est, i, s);
+            }
+            est->n[i] += s;
+        }
+    }
+    est->count++;
+}
+
+static double p2_value(const P2Quantile *est) {
+    if (est->count == 0) return 0.0;
+    if (est->count >= 5) return est->q[2];
+
+    // Con pocas muestras se usa el percentil exacto
+    double sorted[5];
+    memcpy(sorted, est->q, est->count * sizeof(double));
+    qsort(sorted, est->count, sizeof(double), compare_doubles);
+    size_t idx = (size_t)lround(est->p * (double)(est->count - 1));
+    return sorted[idx];
+}
+
+/* ---------- Estadísticas móviles ---------- */
+
+static const double QUANTILE_TARGETS[STAT_QUANTILE_COUNT] = {
+    [STAT_P50] = 0.50,
+    [STAT_P90] = 0.90,
+    [STAT_P99] = 0.99
+};
+
+void rolling_stats_init(RollingStats *rs, size_t window, double max_age, double alpha) {
+    memset(rs, 0, sizeof(*rs));
+    rs->window = window;
+    rs->max_age = max_age;
+    rs->alpha = (alpha > 0 && alpha <= 1) ? alpha : 0.2;
+
+    // Con ventana por muestras no hace falta crecer nunca
+    if (window > 0) {
+        deque_reserve(&rs->samples, window + 1);
+        deque_reserve(&rs->min_q, window + 1);
+        deque_reserve(&rs->max_q, window + 1);
+    }
+
+    for (int i = 0; i < STAT_QUANTILE_COUNT; i++) {
+        p2_init(&rs->quantiles[i][0], QUANTILE_TARGETS[i]);
+        p2_init(&rs->quantiles[i][1], QUANTILE_TARGETS[i]);
+    }
+}
+
+void rolling_stats_free(RollingStats *rs) {
+    if (!rs) return;
+    free(rs->samples.items);
+    free(rs->min_q.items);
+    free(rs->max_q.items);
+    memset(rs, 0, sizeof(*rs));
+}
+
+void rolling_stats_reset(RollingStats *rs) {
+    rs->samples.len = 0;
+    rs->min_q.len = 0;
+    rs->max_q.len = 0;
+    rs->next_seq = 0;
+    rs->mean = 0;
+    rs->m2 = 0;
+    rs->ewma = 0;
+    rs->ewma_ready = 0;
+    for (int i = 0; i < STAT_QUANTILE_COUNT; i++) {
+        p2_reset(&rs->quantiles[i][0]);
+        p2_reset(&rs->quantiles[i][1]);
+    }
+}
+
+// Saca la muestra más antigua de la ventana y deshace su aportación
+static void evict_oldest(RollingStats *rs) {
+    StatSample s = deque_pop_front(&rs->samples);
+
+    size_t n = rs->samples.len;
+    if (n == 0) {
+        rs->mean = 0;
+        rs->m2 = 0;
+    } else {
+        double delta = s.v - rs->mean;
+        rs->mean -= delta / n;
+        rs->m2 -= delta * (s.v - rs->mean);
+        if (rs->m2 < 0) rs->m2 = 0;
+    }
+
+    if (rs->min_q.len > 0 && deque_front(&rs->min_q)->seq == s.seq) deque_pop_front(&rs->min_q);
+    if (rs->max_q.len > 0 && deque_front(&rs->max_q)->seq == s.seq) deque_pop_front(&rs->max_q);
+}
+
+// Reinicia los estimadores P² que han cubierto una ventana completa
+static int quantile_expired(const RollingStats *rs, const P2Quantile *est, double t) {
+    if (est->count == 0) return 0;
+    if (rs->window > 0 && est->count >= rs->window) return 1;
+    if (rs->max_age > 0 && t - est->started_at >= rs->max_age) return 1;
+    return 0;
+}
+
+// El segundo estimador arranca con media ventana de retraso
+static int second_quantile_started(const RollingStats *rs, const P2Quantile *est, double t) {
+    if (est->count > 0) return 1;
+    if (rs->window > 0) return rs->next_seq >= rs->window / 2;
+    if (rs->max_age > 0) return t - rs->quantiles[0][0].started_at >= rs->max_age / 2;
+    return 0;
+}
+
+void rolling_stats_push(RollingStats *rs, double t, double v) {
+    StatSample s = { t, v, rs->next_seq };
+    if (!deque_push_back(&rs->samples, s)) return;
+
+    // Las colas monótonas nunca tienen más elementos que la ventana: con su
+    // misma capacidad reservada antes de vaciarlas, sus inserciones no fallan
+    if (!deque_reserve(&rs->min_q, rs->samples.capacity) ||
+        !deque_reserve(&rs->max_q, rs->samples.capacity)) {
+        deque_pop_back(&rs->samples);
+        return;
+    }
+    rs->next_seq++;
+
+    // Welford
+    size_t n = rs->samples.len;
+    double delta = v - rs->mean;
+    rs->mean += delta / n;
+    rs->m2 += delta * (v - rs->mean);
+
+    // Colas monótonas
+    while (rs->min_q.len > 0 && deque_back(&rs->min_q)->v >= v) deque_pop_back(&rs->min_q);
+    deque_push_back(&rs->min_q, s);
+    while (rs->max_q.len > 0 && deque_back(&rs->max_q)->v <= v) deque_pop_back(&rs->max_q);
+    deque_push_back(&rs->max_q, s);
+
+    // EWMA
+    if (!rs->ewma_ready) {
+        rs->ewma = v;
+        rs->ewma_ready = 1;
+    } else {
+        rs->ewma += rs->alpha * (v - rs->ewma);
+    }
+
+    // Percentiles
+    for (int i = 0; i < STAT_QUANTILE_COUNT; i++) {
+        P2Quantile *first = &rs->quantiles[i][0];
+        P2Quantile *second = &rs->quantiles[i][1];
+
+        if (quantile_expired(rs, first, t)) p2_reset(first);
+        p2_add(first, t, v);
+
+        if (quantile_expired(rs, second, t)) p2_reset(second);
+        if (second_quantile_started(rs, second, t)) p2_add(second, t, v);
+    }
+
+    // Ajustar la ventana
+    if (rs->window > 0) {
+        while (rs->samples.len > rs->window) evict_oldest(rs);
+    }
+    if (rs->max_age > 0) {
+        rolling_stats_evict_before(rs, t - rs->max_age);
+    }
+}
+
+void rolling_stats_evict_before(RollingStats *rs, double t) {
+    while (rs->samples.len > 0 && deque_front(&rs->samples)->t < t) {
+        evict_oldest(rs);
+    }
+}
+
+size_t rolling_stats_count(const RollingStats *rs) {
+    return rs->samples.len;
+}
+
+double rolling_stats_last(const RollingStats *rs) {
+    return rs->samples.len > 0 ? deque_back(&rs->samples)->v : 0.0;
+}
+
+double rolling_stats_min(const RollingStats *rs) {
+    return rs->min_q.len > 0 ? deque_front(&rs->min_q)->v : 0.0;
+}
+
+double rolling_stats_max(const RollingStats *rs) {
+    return rs->max_q.len > 0 ? deque_front(&rs->max_q)->v : 0.0;
+}
+
+double rolling_stats_mean(const RollingStats *rs) {
+    return rs->mean;
+}
+
+double rolling_stats_variance(const RollingStats *rs) {
+    return rs->samples.len > 1 ? rs->m2 / (rs->samples.len - 1) : 0.0;
+}
+
+double rolling_stats_ewma(const RollingStats *rs) {
+    return rs->ewma;
+}
+
+double rolling_stats_quantile(const RollingStats *rs, StatQuantile which) {
+    if ((int)which < 0 || which >= STAT_QUANTILE_COUNT) return 0.0;
+
+    // Se responde con el estimador que más muestras ha visto
+    const P2Quantile *first = &rs->quantiles[which][0];
+    const P2Quantile *second = &rs->quantiles[which][1];
+    return p2_value(second->count > first->count ? second : first);
+}
+
+void rolling_stats_summary(const RollingStats *rs, StatSummary *out) {
+    out->count = rolling_stats_count(rs);
+    out->last = rolling_stats_last(rs);
+    out->min = rolling_stats_min(rs);
+    out->max = rolling_stats_max(rs);
+    out->mean = rolling_stats_mean(rs);
+    out->stddev = sqrt(rolling_stats_variance(rs));
+    out->ewma = rolling_stats_ewma(rs);
+    for (int i = 0; i < STAT_QUANTILE_COUNT; i++) {
+        out->quantiles[i] = rolling_stats_quantile(rs, (StatQuantile)i);
+    }
+}
+
+/* ---------- Estadísticas por nivel de tarifa ---------- */
+
+void fee_stats_init(FeeStats *stats, size_t window, double max_age, double alpha) {
+    for (int i = 0; i < FEE_TIER_COUNT; i++) {
+        rolling_stats_init(&stats->tiers[i], window, max_age, alpha);
+    }
+}
+
+void fee_stats_free(FeeStats *stats) {
+    if (!stats) return;
+    for (int i = 0; i < FEE_TIER_COUNT; i++) {
+        rolling_stats_free(&stats->tiers[i]);
+    }
+}
+
+void fee_stats_push(FeeStats *stats, double t, const double *values, int count) {
+    if (count > FEE_TIER_COUNT) count = FEE_TIER_COUNT;
+    for (int i = 0; i < count; i++) {
+        rolling_stats_push(&stats->tiers[i], t, values[i]);
+    }
+}
+
+double fee_stats_max(const FeeStats *stats, int count) {
+    double max = 0.0;
+    if (count > FEE_TIER_COUNT) count = FEE_TIER_COUNT;
+    for (int i = 0; i < count; i++) {
+        if (rolling_stats_count(&stats->tiers[i]) > 0 && rolling_stats_max(&stats->tiers[i]) > max) {
+            max = rolling_stats_max(&stats->tiers[i]);
+        }
+    }
+    return max;
+}
@@ -0,0 +1,141 @@
+#include "fee_store.h"
+#include "file_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+static const char *SCHEMA_SQL =
+    "PRAGMA journal_mode=WAL;"
+    "PRAGMA synchronous=NORMAL;"
+    "CREATE TABLE IF NOT EXISTS fee_history ("
+    "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "timestamp INTEGER NOT NULL,"
+    "fastest_fee REAL NOT NULL,"
+    "half_hour_fee REAL NOT NULL,"
+    "hour_fee REAL NOT NULL,"
+    "economy_fee REAL NOT NULL,"
+    "minimum_fee REAL NOT NULL"
+    ");";
+
+static const char *INSERT_SQL =
+    "INSERT INTO fee_history (timestamp, fastest_fee, half_hour_fee, hour_fee, economy_fee, minimum_fee) "
+    "VALUES (?, ?, ?, ?, ?, ?);";
+
+static int exec_sql(FeeStore *store, const char *sql, const char *what) {
+    char *err_msg = NULL;
+    if (sqlite3_exec(store->db, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        fprintf(stderr, "Error de la base de datos (%s): %s\n", what, err_msg ? err_msg : "desconocido");
+        sqlite3_free(err_msg);
+        return 0;
+    }
+    return 1;
+}
+
+int fee_store_default_path(char *buffer, size_t size) {
+    const char *home = getenv("HOME");
+    if (!home || !*home) return 0;
+    
+    int len = snprintf(buffer, size, "%s/.local/share/btc-fee-tracker/data.db", home);
+    return len > 0 && (size_t)len < size;
+}
+
+int fee_store_open(FeeStore *store, const char *path) {
+    memset(store, 0, sizeof(*store));
+    
+    if (!file_make_parent_dirs(path)) {
+        fprintf(stderr, "No se pudo crear el directorio de la base de datos %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+    
+    if (sqlite3_open(path, &store->db) != SQLITE_OK) {
+        fprintf(stderr, "No se pudo abrir la base de datos %s: %s\n", path, sqlite3_errmsg(store->db));
+        sqlite3_close(store->db);
+        store->db = NULL;
+        return 0;
+    }
+    
+    // Espera al otro escritor (interfaz gráfica o colector) en vez de fallar
+    sqlite3_busy_timeout(store->db, FEE_STORE_BUSY_TIMEOUT_MS);
+    
+    if (!exec_sql(store, SCHEMA_SQL, "esquema") ||
+        sqlite3_prepare_v2(store->db, INSERT_SQL, -1, &store->insert, NULL) != SQLITE_OK) {
+        fprintf(stderr, "No se pudo preparar la base de datos: %s\n", sqlite3_errmsg(store->db));
+        fee_store_close(store);
+        return 0;
+    }
+    
+    return 1;
+}
+
+int fee_store_append(FeeStore *store, const FeeSnapshot *snapshot) {
+    if (!store->db || !snapshot) return 0;
+    
+    // Un lote lleno que no se pudo escribir cede su fila más antigua
+    if (store->pending == FEE_STORE_BATCH_ROWS) {
+        memmove(store->rows, store->rows + 1, (FEE_STORE_BATCH_ROWS - 1) * sizeof(FeeStoreRow));
+        store->pending--;
+    }
+    if (store->pending == 0) store->batch_started = time(NULL);
+    
+    const FeeMetrics *m = &snapshot->metrics;
+    FeeStoreRow *row = &store->rows[store->pending++];
+    row->timestamp = snapshot->timestamp;
+    row->fastest_fee = m->fastest_fee;
+    row->half_hour_fee = m->half_hour_fee;
+    row->hour_fee = m->hour_fee;
+    row->economy_fee = m->economy_fee;
+    row->minimum_fee = m->minimum_fee;
+    
+    if (store->pending == FEE_STORE_BATCH_ROWS) return fee_store_flush(store);
+    return 1;
+}
+
+int fee_store_flush_due(FeeStore *store, time_t now) {
+    if (store->pending == 0 || now - store->batch_started < FEE_STORE_BATCH_SECONDS) return 1;
+    return fee_store_flush(store);
+}
+
+int fee_store_flush(FeeStore *store) {
+    if (!store->db) return 0;
+    if (store->pending == 0) return 1;
+    
+    // La transacción solo dura lo que tardan las inserciones del lote
+    if (!exec_sql(store, "BEGIN IMMEDIATE;", "inicio de lote")) return 0;
+    
+    int ok = 1;
+    for (int i = 0; i < store->pending && ok; i++) {
+        const FeeStoreRow *row = &store->rows[i];
+        sqlite3_bind_int64(store->insert, 1, row->timestamp);
+        sqlite3_bind_double(store->insert, 2, row->fastest_fee);
+        sqlite3_bind_double(store->insert, 3, row->half_hour_fee);
+        sqlite3_bind_double(store->insert, 4, row->hour_fee);
+        sqlite3_bind_double(store->insert, 5, row->economy_fee);
+        sqlite3_bind_double(store->insert, 6, row->minimum_fee);
+        
+        ok = sqlite3_step(store->insert) == SQLITE_DONE;
+        if (!ok) {
+            fprintf(stderr, "No se pudo insertar en la base de datos: %s\n", sqlite3_errmsg(store->db));
+        }
+        sqlite3_reset(store->insert);
+    }
+    
+    if (ok) ok = exec_sql(store, "COMMIT;", "fin de lote");
+    if (!ok) {
+        // Las filas siguen en memoria y se reintentan en el próximo volcado
+        exec_sql(store, "ROLLBACK;", "descarte de lote");
+        return 0;
+    }
+    
+    store->pending = 0;
+    return 1;
+}
+
+void fee_store_close(FeeStore *store) {
+    if (!store->db) return;
+    
+    fee_store_flush(store);
+    sqlite3_finalize(store->insert);
+    sqlite3_close(store->db);
+    memset(store, 0, sizeof(*store));
+}
@@ -0,0 +1,25 @@
+#include "file_utils.h"
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+int file_make_parent_dirs(const char *path) {
+    char dir[4096];
+    if (strlen(path) >= sizeof(dir)) {
+        errno = ENAMETOOLONG;
+        return 0;
+    }
+    strcpy(dir, path);
+    
+    char *slash = strrchr(dir, '/');
+    if (!slash || slash == dir) return 1;
+    *slash = '\0';
+    
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST) return 0;
+        *p = '/';
+    }
+    return mkdir(dir, 0755) == 0 || errno == EEXIST;
+}
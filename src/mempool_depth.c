@@ -0,0 +1,219 @@
+#include "mempool_depth.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Par del histograma antes de acumular
+typedef struct {
+    double fee_rate;
+    double vsize;
+} HistogramBucket;
+
+static int bucket_compare_desc(const void *a, const void *b) {
+    double fa = ((const HistogramBucket *)a)->fee_rate;
+    double fb = ((const HistogramBucket *)b)->fee_rate;
+    return (fa < fb) - (fa > fb);
+}
+
+static double json_number(const cJSON *object, const char *key, double fallback) {
+    const cJSON *item = cJSON_GetObjectItemCaseSensitive(object, key);
+    return cJSON_IsNumber(item) ? item->valuedouble : fallback;
+}
+
+MempoolDepth *mempool_depth_new(void) {
+    MempoolDepth *depth = calloc(1, sizeof(MempoolDepth));
+    if (!depth) return NULL;
+
+    atomic_init(&depth->refcount, 1);
+    return depth;
+}
+
+MempoolDepth *mempool_depth_ref(MempoolDepth *depth) {
+    if (depth) atomic_fetch_add(&depth->refcount, 1);
+    return depth;
+}
+
+void mempool_depth_unref(MempoolDepth *depth) {
+    if (!depth || atomic_fetch_sub(&depth->refcount, 1) != 1) return;
+
+    free(depth->fee_rates);
+    free(depth->cum_vsize);
+    free(depth->blocks);
+    free(depth->block_cum_vsize);
+    free(depth);
+}
+
+size_t mempool_depth_load_histogram(MempoolDepth *depth, const cJSON *histogram) {
+    if (!depth || !cJSON_IsArray(histogram)) return 0;
+
+    int size = cJSON_GetArraySize(histogram);
+    if (size <= 0) return 0;
+
+    HistogramBucket *buckets = malloc((size_t)size * sizeof(HistogramBucket));
+    double *fee_rates = malloc((size_t)size * sizeof(double));
+    double *cum_vsize = malloc((size_t)size * sizeof(double));
+    if (!buckets || !fee_rates || !cum_vsize) {
+        free(buckets);
+        free(fee_rates);
+        free(cum_vsize);
+        return 0;
+    }
+
+    // Copiar los pares válidos comprobando de paso el orden
+    size_t count = 0;
+    int sorted = 1;
+    const cJSON *pair;
+    cJSON_ArrayForEach(pair, histogram) {
+        const cJSON *rate = cJSON_GetArrayItem(pair, 0);
+        const cJSON *vsize = cJSON_GetArrayItem(pair, 1);
+        if (!cJSON_IsNumber(rate) || !cJSON_IsNumber(vsize) || vsize->valuedouble <= 0) continue;
+
+        buckets[count].fee_rate = rate->valuedouble;
+        buckets[count].vsize = vsize->valuedouble;
+        if (count > 0 && buckets[count].fee_rate > buckets[count - 1].fee_rate) sorted = 0;
+        count++;
+    }
+
+    // La API ya lo entrega ordenado; solo se ordena si alguna fuente no lo hace
+    if (!sorted) {
+        qsort(buckets, count, sizeof(HistogramBucket), bucket_compare_desc);
+    }
+
+    double total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += buckets[i].vsize;
+        fee_rates[i] = buckets[i].fee_rate;
+        cum_vsize[i] = total;
+    }
+    free(buckets);
+
+    free(depth->fee_rates);
+    free(depth->cum_vsize);
+    depth->fee_rates = fee_rates;
+    depth->cum_vsize = cum_vsize;
+    depth->bucket_count = count;
+    return count;
+}
+
+size_t mempool_depth_load_blocks(MempoolDepth *depth, const cJSON *blocks) {
+    if (!depth || !cJSON_IsArray(blocks)) return 0;
+
+    int size = cJSON_GetArraySize(blocks);
+    if (size <= 0) return 0;
+
+    MempoolProjectedBlock *projected = malloc((size_t)size * sizeof(MempoolProjectedBlock));
+    double *cum_vsize = malloc((size_t)size * sizeof(double));
+    if (!projected || !cum_vsize) {
+        free(projected);
+        free(cum_vsize);
+        return 0;
+    }
+
+    size_t count = 0;
+    double total = 0;
+    const cJSON *block;
+    cJSON_ArrayForEach(block, blocks) {
+        if (!cJSON_IsObject(block)) continue;
+
+        MempoolProjectedBlock *b = &projected[count];
+        b->vsize = json_number(block, "blockVSize", 0);
+        b->median_fee = json_number(block, "medianFee", 0);
+        b->total_fees = json_number(block, "totalFees", 0);
+        b->tx_count = (int64_t)json_number(block, "nTx", 0);
+
+        // El primer valor de feeRange es la tarifa más baja que entra en el bloque
+        const cJSON *range = cJSON_GetObjectItemCaseSensitive(block, "feeRange");
+        const cJSON *lowest = cJSON_GetArrayItem(range, 0);
+        b->min_fee = cJSON_IsNumber(lowest) ? lowest->valuedouble : b->median_fee;
+
+        total += b->vsize;
+        cum_vsize[count] = total;
+        count++;
+    }
+
+    free(depth->blocks);
+    free(depth->block_cum_vsize);
+    depth->blocks = projected;
+    depth->block_cum_vsize = cum_vsize;
+    depth->block_count = count;
+    return count;
+}
+
+int mempool_depth_equal(const MempoolDepth *a, const MempoolDepth *b) {
+    if (a == b) return 1;
+    if (!a || !b) return 0;
+    if (a->bucket_count != b->bucket_count || a->block_count != b->block_count) return 0;
+
+    size_t buckets = a->bucket_count * sizeof(double);
+    size_t blocks = a->block_count * sizeof(MempoolProjectedBlock);
+    return (buckets == 0 || (memcmp(a->fee_rates, b->fee_rates, buckets) == 0 &&
+                             memcmp(a->cum_vsize, b->cum_vsize, buckets) == 0)) &&
+           (blocks == 0 || memcmp(a->blocks, b->blocks, blocks) == 0);
+}
+
+double mempool_depth_total_vsize(const MempoolDepth *depth) {
+    if (!depth || depth->bucket_count == 0) return 0;
+    return depth->cum_vsize[depth->bucket_count - 1];
+}
+
+double mempool_depth_fee_for_vsize(const MempoolDepth *depth, double vsize) {
+    if (!depth || depth->bucket_count == 0) return 0;
+    if (vsize >= mempool_depth_total_vsize(depth)) return 0;
+
+    // Primer tramo cuyo acumulado alcanza la profundidad pedida
+    size_t lo = 0, hi = depth->bucket_count - 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (depth->cum_vsize[mid] >= vsize) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return depth->fee_rates[lo];
+}
+
+double mempool_depth_fee_for_target(const MempoolDepth *depth, int target_blocks) {
+    if (!depth) return 0;
+    if (target_blocks < 1) target_blocks = 1;
+
+    // El último bloque proyectado agrupa el resto de la mempool
+    if (depth->block_count > 0) {
+        if ((size_t)target_blocks > depth->block_count) return 0;
+        return depth->blocks[target_blocks - 1].min_fee;
+    }
+
+    return mempool_depth_fee_for_vsize(depth, target_blocks * MEMPOOL_BLOCK_VSIZE);
+}
+
+int mempool_depth_blocks_for_fee(const MempoolDepth *depth, double fee_rate) {
+    if (!depth) return 1;
+
+    // Primer bloque proyectado cuya tarifa mínima no supera la dada
+    if (depth->block_count > 0) {
+        size_t lo = 0, hi = depth->block_count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (depth->blocks[mid].min_fee <= fee_rate) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        return (int)lo + 1;
+    }
+
+    if (depth->bucket_count == 0) return 1;
+
+    // Vbytes con tarifa estrictamente mayor que la dada
+    size_t lo = 0, hi = depth->bucket_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (depth->fee_rates[mid] <= fee_rate) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    double ahead = lo > 0 ? depth->cum_vsize[lo - 1] : 0;
+    return (int)(ahead / MEMPOOL_BLOCK_VSIZE) + 1;
+}
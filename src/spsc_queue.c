@@ -0,0 +1,47 @@
+#include "spsc_queue.h"
+#include <stdlib.h>
+#include <string.h>
+
+int spsc_queue_init(SpscQueue *queue, size_t element_size, size_t capacity) {
+    size_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+    
+    queue->slots = calloc(rounded, element_size);
+    if (!queue->slots) return 0;
+    
+    queue->element_size = element_size;
+    queue->capacity = rounded;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    return 1;
+}
+
+void spsc_queue_free(SpscQueue *queue) {
+    free(queue->slots);
+    queue->slots = NULL;
+    queue->capacity = 0;
+}
+
+int spsc_queue_push(SpscQueue *queue, const void *item) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head == queue->capacity) return 0;
+    
+    memcpy(queue->slots + (tail & (queue->capacity - 1)) * queue->element_size,
+           item, queue->element_size);
+    // El elemento es visible para el consumidor antes que el nuevo final
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+int spsc_queue_pop(SpscQueue *queue, void *item) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) return 0;
+    
+    memcpy(item, queue->slots + (head & (queue->capacity - 1)) * queue->element_size,
+           queue->element_size);
+    // El hueco solo se libera después de copiar el elemento
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return 1;
+}
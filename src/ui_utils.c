@@ -38,7 +38,7 @@ static void add_to_fee_history(time_t timestamp, double fee, const char *fee_typ
 
 // Prototipos de funciones estáticas
 static void apply_css(GtkWidget *widget, GtkCssProvider *provider);
-static void on_theme_changed(GtkSwitch *widget, gboolean state, gpointer user_data);
+static gboolean on_theme_changed(GtkSwitch *widget, gboolean state, gpointer user_data);
 static void on_currency_changed(GtkComboBox *widget, gpointer user_data);
 static void save_config(const AppUI *ui);
 static void load_config(AppUI *ui);
@@ -242,13 +242,14 @@ static void load_config(AppUI *ui) {
 /**
  * Maneja el cambio de tema
  */
-static void on_theme_changed(GtkSwitch *widget, gboolean state, gpointer user_data) {
+static gboolean on_theme_changed(GtkSwitch *widget, gboolean state, gpointer user_data) {
     AppUI *ui = (AppUI *)user_data;
-    if (!ui) return;
+    if (!ui) return FALSE;
     
     ui->current_theme = state ? THEME_DARK : THEME_LIGHT;
     ui_update_theme(ui, ui->current_theme);
     save_config(ui);
+    return FALSE;
 }
 
 /**
@@ -328,6 +329,7 @@ static GtkWidget* create_toolbar(AppUI *ui) {
     GtkWidget *refresh_btn = gtk_button_new_from_icon_name("view-refresh-symbolic", GTK_ICON_SIZE_BUTTON);
     gtk_widget_set_tooltip_text(refresh_btn, "Actualizar datos");
     gtk_header_bar_pack_start(GTK_HEADER_BAR(header), refresh_btn);
+    ui->refresh_button = refresh_btn;
     
     // Selector de moneda
     GtkWidget *currency_combo = create_currency_selector(ui);
@@ -348,7 +350,7 @@ static GtkWidget* create_toolbar(AppUI *ui) {
 /**
  * Crea el panel de tarifas
  */
-static GtkWidget* create_fee_panel(void) {
+static GtkWidget* create_fee_panel(AppUI *ui) {
     GtkWidget *grid = gtk_grid_new();
     gtk_grid_set_column_spacing(GTK_GRID(grid), 8);
     gtk_grid_set_row_spacing(GTK_GRID(grid), 8);
@@ -376,6 +378,7 @@ static GtkWidget* create_fee_panel(void) {
         
         GtkWidget *label = gtk_label_new(titles[i]);
         GtkWidget *value = gtk_label_new("--");
+        ui->fee_labels[i] = value;
         GtkStyleContext *value_context = gtk_widget_get_style_context(value);
         gtk_style_context_add_class(value_context, "fee-value");
         
@@ -388,209 +391,135 @@ static GtkWidget* create_fee_panel(void) {
     return grid;
 }
 
+// Ventana de tiempo de los gráficos en vivo (6 horas)
+#define UI_CHART_TIME_WINDOW (6 * 3600)
+
 /**
- * Inicializa la interfaz de usuario
+ * Registra las series del gráfico de tarifas y guarda sus manejadores
  */
-AppUI* ui_init(GtkApplication *app) {
-    // Inicializar notificaciones
-    notify_init("Gas Fee Tracker");
-    
-    // Crear estructura de la interfaz
-    AppUI *ui = g_malloc0(sizeof(AppUI));
-    if (!ui) {
-        g_critical("No se pudo asignar memoria para la interfaz de usuario");
-        return NULL;
-    }
-    
-    // Cargar configuración
-    load_config(ui);
-    
-    // Crear ventana principal
-    ui->window = gtk_application_window_new(app);
-    gtk_window_set_title(GTK_WINDOW(ui->window), "Gas Fee Tracker");
-    gtk_window_set_default_size(GTK_WINDOW(ui->window), 1000, 700);
-    gtk_window_set_position(GTK_WINDOW(ui->window), GTK_WIN_POS_CENTER);
-    gtk_container_set_border_width(GTK_CONTAINER(ui->window), 0);
-    
-    // Configurar la ventana
-    gtk_window_set_icon_name(GTK_WINDOW(ui->window), "network-transmit-receive");
-    
-    // Crear contenedor principal
-    GtkWidget *main_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
-    gtk_container_add(GTK_CONTAINER(ui->window), main_box);
-    
-    // Añadir barra de herramientas
-    GtkWidget *header = create_toolbar(ui);
-    gtk_box_pack_start(GTK_BOX(main_box), header, FALSE, FALSE, 0);
-    
-    // Crear pila para los paneles
-    ui->stack = gtk_stack_new();
-    gtk_stack_set_transition_type(GTK_STACK(ui->stack), GTK_STACK_TRANSITION_TYPE_SLIDE_LEFT_RIGHT);
-    gtk_stack_set_transition_duration(GTK_STACK(ui->stack), 300);
-    
-    // Crear contenedor para el panel principal
-    GtkWidget *dashboard_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
-    gtk_container_set_border_width(GTK_CONTAINER(dashboard_box), 10);
-    
-    // Crear y configurar gráficos
-    // Gráfico de tarifas
-    GtkWidget *fee_chart_container = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
-    GtkWidget *fee_chart_label = gtk_label_new("Historial de Tarifas");
-    gtk_widget_set_halign(fee_chart_label, GTK_ALIGN_START);
-    gtk_box_pack_start(GTK_BOX(fee_chart_container), fee_chart_label, FALSE, FALSE, 0);
-    
-    // Inicializar gráfico de tarifas
-    ui->fee_chart = chart_config_new(NULL, "Evolución de Tarifas");
-    if (ui->fee_chart) {
-        // Configurar colores de las series
-        GdkRGBA color_fast = {0.8, 0.2, 0.2, 1.0};  // Rojo
-        GdkRGBA color_avg = {0.2, 0.6, 0.2, 1.0};   // Verde
-        GdkRGBA color_slow = {0.2, 0.2, 0.8, 1.0};  // Azul
-        GdkRGBA color_eco = {0.8, 0.5, 0.2, 1.0};   // Naranja
-        
-        // Añadir series al gráfico
-        chart_add_series(ui->fee_chart, "Rápido", &color_fast, TRUE);
-        chart_add_series(ui->fee_chart, "Media Hora", &color_avg, TRUE);
-        chart_add_series(ui->fee_chart, "1 Hora", &color_slow, TRUE);
-        chart_add_series(ui->fee_chart, "Económico", &color_eco, TRUE);
-        
-        // Añadir el gráfico al contenedor
-        gtk_box_pack_start(GTK_BOX(fee_chart_container), ui->fee_chart->drawing_area, TRUE, TRUE, 0);
-    }
-    
-    // Gráfico de precios
-    GtkWidget *price_chart_container = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
-    GtkWidget *price_chart_label = gtk_label_new("Historial de Precios");
-    gtk_widget_set_halign(price_chart_label, GTK_ALIGN_START);
-    gtk_box_pack_start(GTK_BOX(price_chart_container), price_chart_label, FALSE, FALSE, 0);
-    
-    // Inicializar gráfico de precios
-    ui->price_chart = chart_config_new(NULL, "Precio de Bitcoin");
-    if (ui->price_chart) {
-        GdkRGBA color_price = {0.6, 0.2, 0.6, 1.0};  // Púrpura
-        chart_add_series(ui->price_chart, "Precio USD", &color_price, TRUE);
-        gtk_box_pack_start(GTK_BOX(price_chart_container), ui->price_chart->drawing_area, TRUE, TRUE, 0);
-    }
-    
-    // Gráfico de mempool
-    GtkWidget *mempool_chart_container = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
-    GtkWidget *mempool_chart_label = gtk_label_new("Estadísticas de Mempool");
-    gtk_widget_set_halign(mempool_chart_label, GTK_ALIGN_START);
-    gtk_box_pack_start(GTK_BOX(mempool_chart_container), mempool_chart_label, FALSE, FALSE, 0);
-    
-    // Inicializar gráfico de mempool
-    ui->mempool_chart = chart_config_new(NULL, "Estadísticas de Mempool");
-    if (ui->mempool_chart) {
-        GdkRGBA color_tx = {0.2, 0.6, 0.8, 1.0};    // Azul claro
-        GdkRGBA color_size = {0.8, 0.6, 0.2, 1.0};  // Amarillo
-        GdkRGBA color_fee = {0.8, 0.2, 0.2, 1.0};   // Rojo
-        
-        chart_add_series(ui->mempool_chart, "Transacciones", &color_tx, TRUE);
-        chart_add_series(ui->mempool_chart, "Tamaño (MB)", &color_size, TRUE);
-        chart_add_series(ui->mempool_chart, "Tarifa Media", &color_fee, TRUE);
-        
-        gtk_box_pack_start(GTK_BOX(mempool_chart_container), ui->mempool_chart->drawing_area, TRUE, TRUE, 0);
+static void add_fee_chart_series(AppUI *ui) {
+    GdkRGBA color_fast = {0.8, 0.2, 0.2, 1.0};  // Rojo
+    GdkRGBA color_avg = {0.2, 0.6, 0.2, 1.0};   // Verde
+    GdkRGBA color_slow = {0.2, 0.2, 0.8, 1.0};  // Azul
+    GdkRGBA color_eco = {0.8, 0.5, 0.2, 1.0};   // Naranja
+    
+    ui->fee_series[0] = chart_add_series(ui->fee_chart, "Rápido", &color_fast, TRUE);
+    ui->fee_series[1] = chart_add_series(ui->fee_chart, "Media Hora", &color_avg, TRUE);
+    ui->fee_series[2] = chart_add_series(ui->fee_chart, "1 Hora", &color_slow, TRUE);
+    ui->fee_series[3] = chart_add_series(ui->fee_chart, "Económico", &color_eco, TRUE);
+    chart_set_time_window(ui->fee_chart, UI_CHART_TIME_WINDOW);
+}
+
+/**
+ * Registra la serie del gráfico de precios
+ */
+static void add_price_chart_series(AppUI *ui) {
+    GdkRGBA color_price = {0.6, 0.2, 0.6, 1.0};  // Púrpura
+    ui->price_series = chart_add_series(ui->price_chart, "Precio USD", &color_price, TRUE);
+    chart_set_time_window(ui->price_chart, UI_CHART_TIME_WINDOW);
+}
+
+/**
+ * Registra las series del gráfico de mempool
+ */
+static void add_mempool_chart_series(AppUI *ui) {
+    GdkRGBA color_tx = {0.2, 0.6, 0.8, 1.0};    // Azul claro
+    GdkRGBA color_size = {0.8, 0.6, 0.2, 1.0};  // Amarillo
+    GdkRGBA color_fee = {0.8, 0.2, 0.2, 1.0};   // Rojo
+    
+    ui->mempool_series[0] = chart_add_series(ui->mempool_chart, "Transacciones", &color_tx, TRUE);
+    ui->mempool_series[1] = chart_add_series(ui->mempool_chart, "Tamaño (MB)", &color_size, TRUE);
+    ui->mempool_series[2] = chart_add_series(ui->mempool_chart, "Tarifa Media", &color_fee, TRUE);
+    chart_set_time_window(ui->mempool_chart, UI_CHART_TIME_WINDOW);
+}
+
+// Vistas de los gráficos de tarifa y precio: líneas o velas por intervalo (segundos)
+static const struct {
+    const char *label;
+    int64_t interval;
+} chart_views[] = {
+    {"Líneas", 0},
+    {"Velas 1 min", 60},
+    {"Velas 5 min", 300},
+    {"Velas 1 h", 3600},
+    {"Velas 1 día", 86400},
+};
+
+/**
+ * Pasa un gráfico a líneas o lo reconstruye en velas del intervalo dado
+ */
+static void apply_chart_view(ChartConfig *chart, ChartSeriesHandle handle,
+                             CandleAggregator *agg, int64_t interval) {
+    if (!chart) return;
+    
+    if (interval <= 0) {
+        chart_set_type(chart, CHART_TYPE_LINE);
+        chart_clear_candles(chart);
+        candle_aggregator_init(agg, 0);
+        return;
     }
     
-    // Organizar los gráficos en el panel
-    GtkWidget *top_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
-    gtk_box_pack_start(GTK_BOX(dashboard_box), top_box, TRUE, TRUE, 0);
-    
-    // Panel izquierdo (tarifas y precios)
-    GtkWidget *left_panel = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
-    gtk_box_pack_start(GTK_BOX(top_box), left_panel, TRUE, TRUE, 0);
-    
-    // Panel de tarifas
-    GtkWidget *fee_panel = create_fee_panel();
-    gtk_box_pack_start(GTK_BOX(left_panel), fee_panel, FALSE, FALSE, 0);
-    
-    // Gráfico de tarifas
-    gtk_box_pack_start(GTK_BOX(left_panel), fee_chart_container, TRUE, TRUE, 0);
-    
-    // Panel derecho (precios y mempool)
-    GtkWidget *right_panel = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
-    gtk_box_pack_start(GTK_BOX(top_box), right_panel, TRUE, TRUE, 0);
-    
-    // Gráfico de precios
-    gtk_box_pack_start(GTK_BOX(right_panel), price_chart_container, TRUE, TRUE, 0);
-    
-    // Gráfico de mempool
-    gtk_box_pack_start(GTK_BOX(right_panel), mempool_chart_container, TRUE, TRUE, 0);
-    
-    // Añadir el panel principal a la pila
-    gtk_stack_add_titled(GTK_STACK(ui->stack), dashboard_box, "dashboard", "Panel Principal");
-    
-    // Añadir pila al contenedor principal
-    gtk_box_pack_start(GTK_BOX(main_box), ui->stack, TRUE, TRUE, 0);
-    
-    // Añadir barra de estado
-    ui->status_bar = gtk_statusbar_new();
-    gtk_box_pack_end(GTK_BOX(main_box), ui->status_bar, FALSE, FALSE, 0);
-    
-    // Inicializar etiquetas de estado
-    ui->status_label = gtk_label_new("Listo");
-    gtk_widget_set_halign(ui->status_label, GTK_ALIGN_START);
-    gtk_widget_set_margin_start(ui->status_label, 10);
-    gtk_box_pack_start(GTK_BOX(ui->status_bar), ui->status_label, FALSE, FALSE, 0);
-    
-    // Configuración de la interfaz de usuario
-    
-    // Configurar el tema oscuro
-    GtkSettings *settings = gtk_settings_get_default();
-    g_object_set(settings, "gtk-application-prefer-dark-theme", TRUE, NULL);
-    
-    // Cargar estilos CSS desde archivo
-    GtkCssProvider *provider = gtk_css_provider_new();
-    GError *error = NULL;
+    chart_rebuild_candles(chart, handle, interval, agg);
+    chart_set_type(chart, CHART_TYPE_CANDLE);
+}
+
+static void on_chart_view_changed(GtkComboBox *widget, gpointer user_data) {
+    AppUI *ui = (AppUI *)user_data;
+    int active = gtk_combo_box_get_active(widget);
+    if (active < 0 || active >= (int)G_N_ELEMENTS(chart_views)) return;
     
-    gchar *css_path = g_build_filename(g_get_current_dir(), CSS_FILE, NULL);
+    ui->candle_interval = chart_views[active].interval;
+    apply_chart_view(ui->fee_chart, ui->fee_series[0], &ui->fee_candles, ui->candle_interval);
+    apply_chart_view(ui->price_chart, ui->price_series, &ui->price_candles, ui->candle_interval);
+}
+
+/**
+ * Crea el selector de vista de los gráficos
+ */
+static GtkWidget* create_chart_view_selector(AppUI *ui) {
+    GtkWidget *box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    gtk_box_pack_start(GTK_BOX(box), gtk_label_new("Vista:"), FALSE, FALSE, 0);
     
-    if (!gtk_css_provider_load_from_file(provider, g_file_new_for_path(css_path), &error)) {
-        g_warning("Error loading CSS file '%s': %s", css_path, error->message);
-        g_error_free(error);
-    } else {
-        gtk_style_context_add_provider_for_screen(
-            gdk_screen_get_default(),
-            GTK_STYLE_PROVIDER(provider),
-            GTK_STYLE_PROVIDER_PRIORITY_APPLICATION
-        );
+    GtkWidget *combo = gtk_combo_box_text_new();
+    for (size_t i = 0; i < G_N_ELEMENTS(chart_views); i++) {
+        gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(combo), chart_views[i].label);
     }
+    gtk_combo_box_set_active(GTK_COMBO_BOX(combo), 0);
+    g_signal_connect(combo, "changed", G_CALLBACK(on_chart_view_changed), ui);
+    gtk_box_pack_start(GTK_BOX(box), combo, FALSE, FALSE, 0);
     
-    g_free(css_path);
-    // Crear el layout principal
-    ui->main_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
-    gtk_container_add(GTK_CONTAINER(ui->window), ui->main_box);
-    
-    // Crear el encabezado
-    ui->header_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
-    gtk_box_pack_start(GTK_BOX(ui->main_box), ui->header_box, FALSE, FALSE, 0);
-    gtk_widget_set_name(ui->header_box, "header");
-    
-    // Título de la aplicación
-    GtkWidget *title_label = gtk_label_new("BITCOIN FEE TRACKER PRO");
-    gtk_widget_set_name(title_label, "header-title");
-    gtk_box_pack_start(GTK_BOX(ui->header_box), title_label, FALSE, FALSE, 10);
-    
-    // Espaciador
-    GtkWidget *spacer = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
-    gtk_box_pack_start(GTK_BOX(ui->header_box), spacer, TRUE, TRUE, 0);
-    
-    // Botón de actualización manual
-    ui->refresh_button = gtk_button_new_from_icon_name("view-refresh-symbolic", GTK_ICON_SIZE_BUTTON);
-    gtk_widget_set_tooltip_text(ui->refresh_button, "Actualizar datos");
-    gtk_box_pack_end(GTK_BOX(ui->header_box), ui->refresh_button, FALSE, FALSE, 5);
-    
-    // Contenedor principal
-    ui->content_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
-    gtk_box_pack_start(GTK_BOX(ui->main_box), ui->content_box, TRUE, TRUE, 10);
-    gtk_container_set_border_width(GTK_CONTAINER(ui->content_box), 10);
-    
-    // Crear el notebook (pestañas)
-    ui->notebook = gtk_notebook_new();
-    gtk_widget_set_name(ui->notebook, "notebook");
-    gtk_box_pack_start(GTK_BOX(ui->content_box), ui->notebook, TRUE, TRUE, 0);
-    
-    // Pestaña de Resumen
+    ui->chart_view_combo = combo;
+    return box;
+}
+
+/**
+ * Añade una muestra a las velas de un gráfico: la vela cerrada (si la hay) y la
+ * vela en curso, que se sustituye en cada refresco
+ */
+static void feed_candles(ChartConfig *chart, CandleAggregator *agg, time_t timestamp, double value) {
+    if (!chart || agg->interval <= 0) return;
+    
+    CandleData candles[2];
+    int count = 0;
+    if (candle_aggregator_push(agg, timestamp, value, &candles[0])) count++;
+    if (candle_aggregator_current(agg, &candles[count])) count++;
+    chart_add_candle_data(chart, candles, count);
+}
+
+// Páginas del cuaderno, en el orden en que se añaden
+enum {
+    UI_PAGE_SUMMARY,
+    UI_PAGE_CHARTS,
+    UI_PAGE_ALERTS,
+    UI_PAGE_CONFIG,
+    UI_PAGE_COUNT
+};
+
+/**
+ * Construye la pestaña de resumen: tarjetas de tarifas, precio y mempool.
+ * Es la página inicial, así que se crea con la ventana.
+ */
+static GtkWidget* create_summary_page(AppUI *ui) {
     GtkWidget *summary_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
     gtk_container_set_border_width(GTK_CONTAINER(summary_box), 10);
     
@@ -616,7 +545,12 @@ AppUI* ui_init(GtkApplication *app) {
     gtk_widget_set_name(fastest_desc, "fee-label");
     gtk_box_pack_start(GTK_BOX(fastest_card), fastest_desc, FALSE, FALSE, 0);
     
-    // (Añadir más tarjetas de tarifas aquí...)
+    ui->fee_stats_label = gtk_label_new("Media: -- · Mín: -- · Máx: -- · P90: --");
+    gtk_widget_set_name(ui->fee_stats_label, "fee-label");
+    gtk_box_pack_start(GTK_BOX(fastest_card), ui->fee_stats_label, FALSE, FALSE, 0);
+    
+    // Resto de tarifas
+    gtk_box_pack_start(GTK_BOX(fee_box), create_fee_panel(ui), TRUE, TRUE, 0);
     
     // Fila de precios y mempool
     GtkWidget *info_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
@@ -649,31 +583,24 @@ AppUI* ui_init(GtkApplication *app) {
     gtk_widget_set_halign(ui->mempool_label, GTK_ALIGN_START);
     gtk_box_pack_start(GTK_BOX(mempool_card), ui->mempool_label, TRUE, TRUE, 0);
     
-    // Añadir pestaña de resumen
-    gtk_notebook_append_page(GTK_NOTEBOOK(ui->notebook), summary_box, gtk_label_new("Resumen"));
-    
-    // Pestaña de gráficos
-    ui->charts_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
-    gtk_container_set_border_width(GTK_CONTAINER(ui->charts_box), 10);
-    
-    // Inicializar gráficos
-    ui->fee_chart = chart_config_new(ui->charts_box, "Historial de Tarifas (sat/vB)");
-    chart_add_series(ui->fee_chart, "Tarifa más rápida", NULL, TRUE);
-    
-    ui->price_chart = chart_config_new(ui->charts_box, "Precio de Bitcoin (USD)");
-    chart_add_series(ui->price_chart, "Precio USD", NULL, TRUE);
-    
-    ui->mempool_chart = chart_config_new(ui->charts_box, "Tamaño de la Mempool (MB)");
-    chart_add_series(ui->mempool_chart, "Tamaño MB", NULL, FALSE);
-    
-    gtk_notebook_append_page(GTK_NOTEBOOK(ui->notebook), ui->charts_box, gtk_label_new("Gráficos"));
-    
-    // Pestaña de alertas
-    ui->alerts_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
-    gtk_container_set_border_width(GTK_CONTAINER(ui->alerts_box), 10);
-    
-    // Crear modelo para la lista de alertas
-    ui->alerts_store = gtk_list_store_new(4, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_DOUBLE, G_TYPE_STRING);
+    return summary_box;
+}
+
+/**
+ * Rellena la pestaña de gráficos. Los gráficos ya existen sin widget y con
+ * los datos recibidos hasta ahora; aquí solo se les da su área de dibujo.
+ */
+static void build_charts_page(AppUI *ui) {
+    gtk_box_pack_start(GTK_BOX(ui->charts_box), create_chart_view_selector(ui), FALSE, FALSE, 0);
+    chart_attach_widget(ui->fee_chart, ui->charts_box);
+    chart_attach_widget(ui->price_chart, ui->charts_box);
+    chart_attach_widget(ui->mempool_chart, ui->charts_box);
+}
+
+/**
+ * Rellena la pestaña de alertas con la vista del modelo de alertas
+ */
+static void build_alerts_page(AppUI *ui) {
     GtkWidget *alerts_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(ui->alerts_store));
     ui->alerts_view = alerts_view;
     
@@ -705,17 +632,182 @@ AppUI* ui_init(GtkApplication *app) {
     GtkWidget *scrolled = gtk_scrolled_window_new(NULL, NULL);
     gtk_container_add(GTK_CONTAINER(scrolled), alerts_view);
     gtk_box_pack_start(GTK_BOX(ui->alerts_box), scrolled, TRUE, TRUE, 0);
+}
+
+/**
+ * Rellena la pestaña de configuración
+ */
+static void build_config_page(AppUI *ui) {
+    GtkWidget *theme_row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    gtk_box_pack_start(GTK_BOX(ui->config_box), theme_row, FALSE, FALSE, 0);
+    
+    GtkWidget *theme_label = gtk_label_new("Tema oscuro");
+    gtk_widget_set_halign(theme_label, GTK_ALIGN_START);
+    gtk_box_pack_start(GTK_BOX(theme_row), theme_label, TRUE, TRUE, 0);
+    
+    ui->theme_switch = gtk_switch_new();
+    gtk_switch_set_active(GTK_SWITCH(ui->theme_switch), ui->current_theme == THEME_DARK);
+    g_signal_connect(ui->theme_switch, "state-set", G_CALLBACK(on_theme_changed), ui);
+    gtk_box_pack_end(GTK_BOX(theme_row), ui->theme_switch, FALSE, FALSE, 0);
+}
+
+// Constructores de las páginas que se crean al mostrarse por primera vez
+static void (*const page_builders[UI_PAGE_COUNT])(AppUI *ui) = {
+    [UI_PAGE_CHARTS] = build_charts_page,
+    [UI_PAGE_ALERTS] = build_alerts_page,
+    [UI_PAGE_CONFIG] = build_config_page,
+};
+
+/**
+ * Construye el contenido de una pestaña la primera vez que se selecciona
+ */
+static void on_notebook_switch_page(GtkNotebook *notebook, GtkWidget *page,
+                                    guint page_num, gpointer user_data) {
+    AppUI *ui = (AppUI *)user_data;
+    if (page_num >= UI_PAGE_COUNT || !page_builders[page_num]) return;
+    if (ui->built_pages & (1u << page_num)) return;
+    
+    page_builders[page_num](ui);
+    ui->built_pages |= 1u << page_num;
+    gtk_widget_show_all(page);
+}
+
+/**
+ * Carga la hoja de estilos cuando el bucle principal queda libre. La
+ * prioridad de reposo es menor que la de dibujado, así que la ventana se
+ * muestra antes de leer y analizar el CSS.
+ */
+static gboolean load_css_idle(gpointer user_data) {
+    AppUI *ui = (AppUI *)user_data;
+    ui->css_idle_id = 0;
+    
+    GtkCssProvider *provider = gtk_css_provider_new();
+    GError *error = NULL;
+    
+    gchar *current_dir = g_get_current_dir();
+    gchar *css_path = g_build_filename(current_dir, CSS_FILE, NULL);
+    g_free(current_dir);
+    
+    if (!gtk_css_provider_load_from_path(provider, css_path, &error)) {
+        g_warning("Error loading CSS file '%s': %s", css_path, error->message);
+        g_error_free(error);
+        g_object_unref(provider);
+    } else {
+        gtk_style_context_add_provider_for_screen(
+            gdk_screen_get_default(),
+            GTK_STYLE_PROVIDER(provider),
+            GTK_STYLE_PROVIDER_PRIORITY_APPLICATION
+        );
+        ui->css_provider = provider;
+    }
+    
+    g_free(css_path);
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Inicializa la interfaz de usuario
+ */
+AppUI* ui_init(GtkApplication *app) {
+    // Inicializar notificaciones
+    notify_init("Gas Fee Tracker");
+    
+    // Crear estructura de la interfaz
+    AppUI *ui = g_malloc0(sizeof(AppUI));
+    if (!ui) {
+        g_critical("No se pudo asignar memoria para la interfaz de usuario");
+        return NULL;
+    }
+    
+    // Cargar configuración
+    load_config(ui);
+    
+    // Crear ventana principal
+    ui->window = gtk_application_window_new(app);
+    gtk_window_set_title(GTK_WINDOW(ui->window), "Gas Fee Tracker");
+    gtk_window_set_default_size(GTK_WINDOW(ui->window), 1000, 700);
+    gtk_window_set_position(GTK_WINDOW(ui->window), GTK_WIN_POS_CENTER);
+    gtk_container_set_border_width(GTK_CONTAINER(ui->window), 0);
+    
+    // Configurar la ventana
+    gtk_window_set_icon_name(GTK_WINDOW(ui->window), "network-transmit-receive");
+    
+    // Contenedor principal (la ventana solo admite un hijo)
+    ui->main_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+    gtk_container_add(GTK_CONTAINER(ui->window), ui->main_box);
+    
+    // Añadir barra de herramientas
+    ui->header_bar = create_toolbar(ui);
+    gtk_box_pack_start(GTK_BOX(ui->main_box), ui->header_bar, FALSE, FALSE, 0);
+    
+    // Modelos de los gráficos: uno por métrica, alimentados desde el arranque
+    // y sin widget hasta que se abre la pestaña de gráficos
+    ui->fee_chart = chart_config_new_offscreen("Historial de Tarifas (sat/vB)");
+    add_fee_chart_series(ui);
+    
+    ui->price_chart = chart_config_new_offscreen("Precio de Bitcoin (USD)");
+    add_price_chart_series(ui);
+    
+    ui->mempool_chart = chart_config_new_offscreen("Estadísticas de Mempool");
+    add_mempool_chart_series(ui);
+    
+    // Tarifas, precio y mempool comparten eje de tiempo: desplazar o ampliar
+    // uno mueve los tres a la vez
+    ui->chart_viewport = chart_viewport_new();
+    chart_link_viewport(ui->fee_chart, ui->chart_viewport);
+    chart_link_viewport(ui->price_chart, ui->chart_viewport);
+    chart_link_viewport(ui->mempool_chart, ui->chart_viewport);
+    
+    // Modelo de alertas; su vista se crea con la pestaña
+    ui->alerts_store = gtk_list_store_new(4, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_DOUBLE, G_TYPE_STRING);
     
-    // Añadir pestaña de alertas
+    // Contenedor del contenido
+    ui->content_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
+    gtk_box_pack_start(GTK_BOX(ui->main_box), ui->content_box, TRUE, TRUE, 0);
+    gtk_container_set_border_width(GTK_CONTAINER(ui->content_box), 10);
+    
+    // Crear el notebook (pestañas)
+    ui->notebook = gtk_notebook_new();
+    gtk_widget_set_name(ui->notebook, "notebook");
+    gtk_box_pack_start(GTK_BOX(ui->content_box), ui->notebook, TRUE, TRUE, 0);
+    
+    // Pestaña de resumen
+    gtk_notebook_append_page(GTK_NOTEBOOK(ui->notebook), create_summary_page(ui), gtk_label_new("Resumen"));
+    ui->built_pages |= 1u << UI_PAGE_SUMMARY;
+    
+    // Pestañas de gráficos, alertas y configuración: contenedores vacíos que
+    // se rellenan al mostrarse por primera vez
+    ui->charts_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
+    gtk_container_set_border_width(GTK_CONTAINER(ui->charts_box), 10);
+    gtk_notebook_append_page(GTK_NOTEBOOK(ui->notebook), ui->charts_box, gtk_label_new("Gráficos"));
+    
+    ui->alerts_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
+    gtk_container_set_border_width(GTK_CONTAINER(ui->alerts_box), 10);
     gtk_notebook_append_page(GTK_NOTEBOOK(ui->notebook), ui->alerts_box, gtk_label_new("Alertas"));
     
-    // Añadir pestaña de configuración
+    ui->config_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
+    gtk_container_set_border_width(GTK_CONTAINER(ui->config_box), 10);
     gtk_notebook_append_page(GTK_NOTEBOOK(ui->notebook), ui->config_box, gtk_label_new("Configuración"));
     
-    // Inicializar la barra de estado
-    ui->footer_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
-    gtk_widget_set_name(ui->footer_box, "status-bar");
-    gtk_box_pack_end(GTK_BOX(ui->main_box), ui->footer_box, FALSE, FALSE, 0);
+    g_signal_connect(ui->notebook, "switch-page", G_CALLBACK(on_notebook_switch_page), ui);
+    
+    // Añadir barra de estado
+    ui->status_bar = gtk_statusbar_new();
+    gtk_widget_set_name(ui->status_bar, "status-bar");
+    gtk_box_pack_end(GTK_BOX(ui->main_box), ui->status_bar, FALSE, FALSE, 0);
+    
+    // Inicializar etiquetas de estado
+    ui->status_label = gtk_label_new("Listo");
+    gtk_widget_set_halign(ui->status_label, GTK_ALIGN_START);
+    gtk_widget_set_margin_start(ui->status_label, 10);
+    gtk_box_pack_start(GTK_BOX(ui->status_bar), ui->status_label, FALSE, FALSE, 0);
+    
+    // Configurar el tema oscuro
+    GtkSettings *settings = gtk_settings_get_default();
+    g_object_set(settings, "gtk-application-prefer-dark-theme", TRUE, NULL);
+    
+    // Los estilos CSS se cargan fuera del arranque
+    ui->css_idle_id = g_idle_add(load_css_idle, ui);
     
     return ui;
 }
@@ -729,6 +821,12 @@ void ui_cleanup(AppUI *ui) {
     // Liberar recursos de notificaciones
     notify_uninit();
 
+    // Cancelar la carga de estilos si aún no se ha hecho
+    if (ui->css_idle_id) {
+        g_source_remove(ui->css_idle_id);
+        ui->css_idle_id = 0;
+    }
+
     // Liberar recursos de los gráficos
     if (ui->fee_chart) {
         chart_config_free(ui->fee_chart);
@@ -745,6 +843,13 @@ void ui_cleanup(AppUI *ui) {
         ui->mempool_chart = NULL;
     }
 
+    chart_viewport_unref(ui->chart_viewport);
+    ui->chart_viewport = NULL;
+
+    // Soltar la última instantánea mostrada
+    fee_snapshot_unref(ui->snapshot);
+    ui->snapshot = NULL;
+
     // Liberar proveedor CSS
     if (ui->css_provider) {
         gtk_style_context_remove_provider_for_screen(
@@ -762,15 +867,31 @@ void ui_cleanup(AppUI *ui) {
     g_free(ui);
 }
 
-void ui_update_fee_info(
-    AppUI *ui, 
-    double fastest, 
-    double halfHour, 
-    double hour, 
-    double economy, 
-    double minimum
-) {
-    if (ui && ui->fee_label) {
+// Muestra una instantánea si su versión aún no se ha mostrado
+void ui_update_snapshot(AppUI *ui, FeeSnapshot *snapshot) {
+    if (!ui || !fee_snapshot_changed(snapshot, ui->snapshot_version)) return;
+    
+    FeeSnapshot *old = ui->snapshot;
+    ui->snapshot = fee_snapshot_ref(snapshot);
+    ui->snapshot_version = snapshot->version;
+    fee_snapshot_unref(old);
+    
+    ui_update_fee_info(ui, snapshot);
+    ui_update_price_info(ui, snapshot);
+    ui_update_mempool_info(ui, snapshot);
+}
+
+void ui_update_fee_info(AppUI *ui, const FeeSnapshot *snapshot) {
+    if (!ui || !snapshot) return;
+    
+    const FeeMetrics *m = &snapshot->metrics;
+    double fastest = m->fastest_fee;
+    double halfHour = m->half_hour_fee;
+    double hour = m->hour_fee;
+    double economy = m->economy_fee;
+    double minimum = m->minimum_fee;
+    
+    if (ui->fee_label) {
         char buffer[128];
         snprintf(buffer, sizeof(buffer), 
                 "<b>Tarifas actuales:</b> Rápido: %.0f sat/vB | 30 min: %.0f sat/vB | 1h: %.0f sat/vB | Económico: %.0f sat/vB | Mínimo: %.0f sat/vB",
@@ -779,7 +900,7 @@ void ui_update_fee_info(
     }
     
     // Actualizar etiquetas individuales si están inicializadas
-    if (ui && ui->fee_labels[0]) {
+    if (ui->fee_labels[0]) {
         char buffer[32];
         
         snprintf(buffer, sizeof(buffer), "%.0f sat/vB", fastest);
@@ -798,30 +919,47 @@ void ui_update_fee_info(
         gtk_label_set_text(GTK_LABEL(ui->fee_labels[4]), buffer);
     }
     
-    // Actualizar gráfico de tarifas
+    // Actualizar gráfico de tarifas (un solo lote y un solo redibujado)
     if (ui->fee_chart) {
-        time_t now = time(NULL);
-        
-        // Añadir puntos a las series del gráfico
-        chart_add_point(ui->fee_chart, "Rápido", now, fastest);
-        chart_add_point(ui->fee_chart, "Media Hora", now, halfHour);
-        chart_add_point(ui->fee_chart, "1 Hora", now, hour);
-        chart_add_point(ui->fee_chart, "Económico", now, economy);
-        
-        // Redibujar el gráfico
-        gtk_widget_queue_draw(ui->fee_chart->drawing_area);
+        double values[4] = { fastest, halfHour, hour, economy };
+        chart_append_values(ui->fee_chart, snapshot->timestamp, ui->fee_series, values, 4);
+        feed_candles(ui->fee_chart, &ui->fee_candles, snapshot->timestamp, fastest);
     }
     
     // Actualizar estado
     char status[256];
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
+    struct tm *tm_info = localtime(&snapshot->timestamp);
     strftime(status, sizeof(status), "Actualizado: %H:%M:%S", tm_info);
     gtk_label_set_text(GTK_LABEL(ui->status_label), status);
 }
 
+// Actualiza las estadísticas móviles de la tarifa rápida
+void ui_update_fee_stats(AppUI *ui, const StatSummary *fastest) {
+    if (!ui || !ui->fee_stats_label || !fastest || fastest->count == 0) return;
+    
+    char buffer[160];
+    snprintf(buffer, sizeof(buffer),
+            "Media: %.1f · Mín: %.0f · Máx: %.0f · P90: %.1f",
+            fastest->mean, fastest->min, fastest->max, fastest->quantiles[STAT_P90]);
+    gtk_label_set_text(GTK_LABEL(ui->fee_stats_label), buffer);
+    
+    // Detalle completo en el tooltip
+    char tooltip[256];
+    snprintf(tooltip, sizeof(tooltip),
+            "Ventana de %zu muestras\nEWMA: %.1f sat/vB\nDesviación: %.2f\nP50: %.1f · P99: %.1f",
+            fastest->count, fastest->ewma, fastest->stddev,
+            fastest->quantiles[STAT_P50], fastest->quantiles[STAT_P99]);
+    gtk_widget_set_tooltip_text(ui->fee_stats_label, tooltip);
+}
+
 // Actualiza la información de precios en la interfaz
-void ui_update_price_info(AppUI *ui, double usd, double eur, double change24h) {
+void ui_update_price_info(AppUI *ui, const FeeSnapshot *snapshot) {
+    if (!ui || !snapshot) return;
+    
+    double usd = snapshot->metrics.btc_price_usd;
+    double eur = snapshot->metrics.btc_price_eur;
+    double change24h = snapshot->metrics.price_change_24h;
+    
     // Actualizar etiquetas de precios
     if (ui->price_label) {
         char buffer[128];
@@ -839,39 +977,51 @@ void ui_update_price_info(AppUI *ui, double usd, double eur, double change24h) {
     
     // Actualizar gráfico de precios
     if (ui->price_chart) {
-        time_t now = time(NULL);
-        chart_add_point(ui->price_chart, "Precio USD", now, usd);
-        gtk_widget_queue_draw(ui->price_chart->drawing_area);
+        chart_append_values(ui->price_chart, snapshot->timestamp, &ui->price_series, &usd, 1);
+        feed_candles(ui->price_chart, &ui->price_candles, snapshot->timestamp, usd);
     }
 }
 
 // Actualiza la información de la mempool en la interfaz
-void ui_update_mempool_info(AppUI *ui, int count, int size, double total_fee, double avg_fee) {
+void ui_update_mempool_info(AppUI *ui, const FeeSnapshot *snapshot) {
+    if (!ui || !snapshot) return;
+    
+    const FeeMetrics *m = &snapshot->metrics;
+    double size = (double)m->mempool_vsize;
+    double avg_fee = m->mempool_avg_fee;
+    
     // Actualizar etiqueta de mempool
     if (ui->mempool_label) {
         char buffer[256];
         double size_mb = size / 1024.0 / 1024.0; // Convertir a MB
         
         snprintf(buffer, sizeof(buffer),
-                "<b>Mempool:</b> %d transacciones (%.2f MB)  |  "
+                "<b>Mempool:</b> %lld transacciones (%.2f MB)  |  "
                 "<b>Tarifa media:</b> %.2f sat/vB  |  "
                 "<b>Tarifa total:</b> %.4f BTC",
-                count, size_mb, avg_fee, total_fee);
+                (long long)m->mempool_tx_count, size_mb, avg_fee, m->mempool_total_fee);
                 
         gtk_label_set_markup(GTK_LABEL(ui->mempool_label), buffer);
+        
+        // Tarifa por objetivo de confirmación calculada localmente
+        if (snapshot->depth) {
+            const int targets[] = { 1, 3, 6, 12 };
+            GString *tooltip = g_string_new("Tarifa necesaria por objetivo:");
+            for (size_t i = 0; i < G_N_ELEMENTS(targets); i++) {
+                double fee = fmax(mempool_depth_fee_for_target(snapshot->depth, targets[i]),
+                                  m->minimum_fee);
+                g_string_append_printf(tooltip, "\n%d %s: %.1f sat/vB", targets[i],
+                                       targets[i] == 1 ? "bloque" : "bloques", fee);
+            }
+            gtk_widget_set_tooltip_text(ui->mempool_label, tooltip->str);
+            g_string_free(tooltip, TRUE);
+        }
     }
     
     // Actualizar gráfico de mempool
     if (ui->mempool_chart) {
-        time_t now = time(NULL);
-        
-        // Añadir puntos a las series del gráfico
-        chart_add_point(ui->mempool_chart, "Transacciones", now, count);
-        chart_add_point(ui->mempool_chart, "Tamaño (MB)", now, size / 1024.0 / 1024.0);
-        chart_add_point(ui->mempool_chart, "Tarifa Media", now, avg_fee);
-        
-        // Redibujar el gráfico
-        gtk_widget_queue_draw(ui->mempool_chart->drawing_area);
+        double values[3] = { (double)m->mempool_tx_count, size / 1024.0 / 1024.0, avg_fee };
+        chart_append_values(ui->mempool_chart, snapshot->timestamp, ui->mempool_series, values, 3);
     }
     // Chart updates complete
 }